@@ -0,0 +1,98 @@
+// Spatial Index Library
+//
+// Copyright (C) 2004  Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+#pragma once
+
+#include <cmath>
+
+namespace SpatialIndex
+{
+	// A point with a fixed number of dimensions D, stored inline. It has no virtual
+	// methods and every loop has a trip count known at compile time, so the kernels
+	// are unrolled for D = 2 and 3. Use Point for shapes passed to an index.
+	template <uint32_t D>
+	class PointN
+	{
+	public:
+		PointN()
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim) m_pCoords[cDim] = 0.0;
+		}
+
+		explicit PointN(const double* pCoords)
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim) m_pCoords[cDim] = pCoords[cDim];
+		}
+
+		explicit PointN(const Point& p)
+		{
+			if (p.m_dimension != D)
+				throw Tools::IllegalArgumentException(
+					"PointN::PointN: Point has the wrong number of dimensions."
+				);
+
+			for (uint32_t cDim = 0; cDim < D; ++cDim) m_pCoords[cDim] = p.m_pCoords[cDim];
+		}
+
+		Point toPoint() const
+		{
+			return Point(m_pCoords, D);
+		}
+
+		uint32_t getDimension() const
+		{
+			return D;
+		}
+
+		double getMinimumDistanceSq(const PointN& p) const
+		{
+			double ret = 0.0;
+
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				double x = m_pCoords[cDim] - p.m_pCoords[cDim];
+				ret += x * x;
+			}
+
+			return ret;
+		}
+
+		double getMinimumDistance(const PointN& p) const
+		{
+			return std::sqrt(getMinimumDistanceSq(p));
+		}
+
+		bool operator==(const PointN& p) const
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				if (m_pCoords[cDim] != p.m_pCoords[cDim]) return false;
+			}
+
+			return true;
+		}
+
+		double m_pCoords[D];
+	}; // PointN
+
+	typedef PointN<2> Point2;
+	typedef PointN<3> Point3;
+}
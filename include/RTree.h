@@ -49,6 +49,12 @@ namespace SpatialIndex
 			IntersectionQuery = 0x2
 		};
 
+		SIDX_DLL enum CoverSelection
+		{
+			CS_AREA = 0x0,
+			CS_DEADSPACE
+		};
+
 		class SIDX_DLL Data : public IData, public Tools::ISerializable
 		{
 		public:
@@ -98,5 +104,169 @@ namespace SpatialIndex
 			id_type& indexIdentifier
 		);
 		SIDX_DLL ISpatialIndex* loadRTree(IStorageManager& in, id_type indexIdentifier);
+
+		// Number of data entries intersecting query. Trees created with AggregateCounts add the stored
+		// count of every index entry contained in query instead of reading its subtree. Data entries
+		// are not passed to v.
+		SIDX_DLL uint64_t countQuery(ISpatialIndex& tree, const IShape& query, IVisitor& v);
+
+		// All nearest neighbor join: every data entry of tree is passed to pv with its nearest data
+		// entry in query and their distance. Both trees are descended together, so the points of a
+		// leaf share the work done above it in query. Mode -1 of hausdorff and mhausdorff uses it.
+		SIDX_DLL void allNearestNeighborJoin(ISpatialIndex& tree, ISpatialIndex& query, IPairVisitor& pv, IVisitor& v);
+
+		// The k closest pairs of data entries between tree and other, passed to pv in ascending order
+		// of distance. Pairs of entries are expanded best first from a single heap ordered on their
+		// minimum distance, and pairs farther than the k-th smallest MaxDist of the pairs still
+		// standing are never queued.
+		SIDX_DLL void closestPairsQuery(ISpatialIndex& tree, ISpatialIndex& other, uint32_t k, IPairVisitor& pv, IVisitor& v);
+
+		// Spatial join of tree and other: every pair of data entries whose MBRs are within distance
+		// of each other, or intersect if distance is 0, is passed to pv with the distance between
+		// them, in batches through IPairVisitor::visitPairs. Node pairs are matched level by level
+		// with a plane sweep of their children along the axis on which they overlap the most.
+		// With WorkerThreads of tree above 1, the node pairs below the roots are joined in parallel
+		// and the visitors are still only called by the calling thread. Nodes read by the other
+		// threads are not passed to IVisitor::visitNode.
+		SIDX_DLL void spatialJoinQuery(ISpatialIndex& tree, ISpatialIndex& other, double distance, IPairVisitor& pv, IVisitor& v);
+
+		// Search of a collection of trees by their Hausdorff distance from query, h(query, item),
+		// or max(h(query, item), h(item, query)) if bSymmetric is set. Candidates are filtered with
+		// the lower bounds of modes 3, 1 and 2 and refined with the exact distance of the given mode.
+		// results holds (distance, position in collection) pairs in ascending order of distance.
+		SIDX_DLL void hausdorffTopK(
+			ISpatialIndex& query,
+			const std::vector<ISpatialIndex*>& collection,
+			uint32_t k,
+			int mode,
+			bool bSymmetric,
+			std::vector<std::pair<double, uint32_t> >& results,
+			IVisitor& v
+		);
+		SIDX_DLL void hausdorffRange(
+			ISpatialIndex& query,
+			const std::vector<ISpatialIndex*>& collection,
+			double eps,
+			int mode,
+			bool bSymmetric,
+			std::vector<std::pair<double, uint32_t> >& results,
+			IVisitor& v
+		);
+
+		// Quality of the selectMBRs bound on a collection: the mean of the mode 2 lower bound over the
+		// exact distance (given mode) on up to samples ordered pairs of the collection, spread evenly.
+		// Pairs at distance 0 are left out. 1 means that the bound is exact, 0 that it is useless.
+		SIDX_DLL double coverTightness(
+			const std::vector<ISpatialIndex*>& collection,
+			uint32_t samples,
+			int mode,
+			IVisitor& v
+		);
+
+		class SIDX_DLL HausdorffBounds
+		{
+		public:
+			HausdorffBounds();
+
+			double m_lb;
+			double m_ub;
+			id_type m_id1;
+			id_type m_id2;
+				// the pair with the largest nearest neighbor distance found so far, or -1.
+		}; // HausdorffBounds
+
+		// Progressive Hausdorff distance h(tree, query). The interval [m_lb, m_ub] is narrowed with the
+		// root MBRs, then the selected MBRs if selectMBRs was called on both trees, then the dual-tree
+		// search of mode -2, and the best interval is returned as soon as m_ub - m_lb <= eps, timeLimit
+		// milliseconds have passed or maxDistCals distances have been computed. A zero timeLimit or
+		// maxDistCals means no limit. m_lb == m_ub when the exact distance was reached.
+		SIDX_DLL void hausdorffProgressive(
+			ISpatialIndex& tree,
+			ISpatialIndex& query,
+			double eps,
+			double timeLimit,
+			uint32_t maxDistCals,
+			HausdorffBounds& result,
+			IVisitor& v
+		);
+
+		// Decides whether h(tree, query), or the MHD if bMean is set, is at most threshold with the
+		// cheapest bound that settles it: the mindist of mode 3, the root MBRs (mode 1), the selected
+		// MBRs (mode 2) if selectMBRs was called on both trees, then the exact distance of the given
+		// mode. The mode of the deciding stage is passed to v.setDecidingMode. The bound that decided
+		// is returned, so it is on the same side of threshold as the distance. id1 and id2 are only
+		// set by the exact stage.
+		SIDX_DLL double hausdorffCascade(
+			ISpatialIndex& tree,
+			ISpatialIndex& query,
+			double threshold,
+			int mode,
+			bool bMean,
+			uint64_t& id1,
+			uint64_t& id2,
+			IVisitor& v
+		);
+
+		// Whether h(tree, query) <= eps. The bounds of the cascade are tried first, then both trees
+		// are searched together until a point of tree is found with no point of query within eps, or
+		// every point of tree is known to have one. v.setDecidingMode receives 3, 1 or 2 if a bound
+		// decided, 0 if the search did.
+		SIDX_DLL bool hausdorffWithin(
+			ISpatialIndex& tree,
+			ISpatialIndex& query,
+			double eps,
+			IVisitor& v
+		);
+
+		// Partial Hausdorff distance: the k-th largest of the nearest neighbor distances from the
+		// points of tree to query, which ignores k - 1 outliers; k = 1 gives h(tree, query). The
+		// dual-tree search of mode -2 drops every entry and point that cannot enter the k largest.
+		// quantileHausdorff takes the quantile-th of the distances in ascending order instead, with
+		// quantile in (0, 1]; 1 gives h(tree, query) and 0.5 the median. id1, id2 receive the pair
+		// at that distance.
+		SIDX_DLL double partialHausdorff(
+			ISpatialIndex& tree,
+			ISpatialIndex& query,
+			uint32_t k,
+			uint64_t& id1,
+			uint64_t& id2,
+			IVisitor& v
+		);
+		SIDX_DLL double quantileHausdorff(
+			ISpatialIndex& tree,
+			ISpatialIndex& query,
+			double quantile,
+			uint64_t& id1,
+			uint64_t& id2,
+			IVisitor& v
+		);
+
+		class SIDX_DLL HausdorffMatrixEntry
+		{
+		public:
+			HausdorffMatrixEntry(uint32_t row, uint32_t column, double dist) : m_row(row), m_column(column), m_dist(dist) {}
+
+			uint32_t m_row;
+			uint32_t m_column;
+			double m_dist;
+		}; // HausdorffMatrixEntry
+
+		// Distances between all pairs of a collection of trees, h(collection[m_row], collection[m_column]),
+		// or the mean nearest neighbor distance if bMean is set. mode selects an in-memory exact engine:
+		// 0, -3 or -4 for the Hausdorff distance and 0 for the mean. Pairs are spread over threads workers,
+		// or one per processor if threads is 0. Only entries no larger than threshold are returned, sorted
+		// on row and column, and the diagonal and the pairs with an empty tree are left out. If bSymmetric
+		// is set, entries hold the larger of both directions and only the upper triangle (m_row < m_column)
+		// is returned.
+		SIDX_DLL void hausdorffMatrix(
+			const std::vector<ISpatialIndex*>& collection,
+			int mode,
+			bool bMean,
+			bool bSymmetric,
+			double threshold,
+			uint32_t threads,
+			std::vector<HausdorffMatrixEntry>& results,
+			IVisitor& v
+		);
 	}
 }
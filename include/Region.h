@@ -84,16 +84,16 @@ namespace SpatialIndex
 		virtual void makeDimension(uint32_t dimension);
 
 
-		double getHausDistLB(const Region r) const;
-		double getHausDistLB(const std::vector<const Region*> vec_pMBR, double max, int& counter) const;
+		double getHausDistLB(const Region& r) const;
+		double getHausDistLB(const std::vector<const Region*>& vec_pMBR, double max, int& counter) const;
 		
 		double getMHausDistLB(const IShape& in) const;
-		double getMHausDistLB(const std::vector<const Region*> vec_pMBR, double max) const;
+		double getMHausDistLB(const std::vector<const Region*>& vec_pMBR, double max) const;
 
 		double getHausDistUB(const IShape& in) const;
 		double getHausDistUB(const Region& in) const;
 		double getHausDistUB(const Point& in) const;
-		double getHausDistUB(const std::vector<const IShape*> vec_pShape) const;
+		double getHausDistUB(const std::vector<const IShape*>& vec_pShape) const;
 
 
 		double getMinimumDistanceSq(const IShape& in) const;
@@ -101,17 +101,24 @@ namespace SpatialIndex
 		double getMinimumDistanceSq(const Point& p) const;
 		double getMaximumDistanceSq(const Region& in) const;
 
+		uint32_t getNumberOfFaces() const;
+		void getFace(uint32_t faceId, Region& out) const;
+		void getFace(uint32_t faceId, double* pLow, double* pHigh) const;
+		double getFaceMinimumDistanceSq(uint32_t faceId, const Region& r) const;
+
 		void getEdge(int edgeId, Region& cout) const;
+		void getEdge(int edgeId, double* pLow, double* pHigh) const;
 
 	private:
 		void initialize(const double* pLow, const double* pHigh, uint32_t dimension);
 		void initialize(uint32_t dimension);
 
+		double getFaceMaximumDistanceSq(uint32_t faceId, const Region& r, uint32_t rFaceId) const;
+
 	public:
 		uint32_t m_dimension;
 		double* m_pLow;
 		double* m_pHigh;
-		std::vector<Region*> m_vec_pEdge;
 
 		friend SIDX_DLL std::ostream& operator<<(std::ostream& os, const Region& r);
 	}; // Region
@@ -0,0 +1,258 @@
+// Spatial Index Library
+//
+// Copyright (C) 2004  Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+namespace SpatialIndex
+{
+	// A region with a fixed number of dimensions D, stored inline, with the same
+	// semantics as Region. Like PointN it has no virtual methods and unrolled kernels.
+	// The methods taking a Region are adapters for MBRs stored in the trees. They read
+	// its first D coordinates and do not check its dimension.
+	template <uint32_t D>
+	class RegionN
+	{
+	public:
+		RegionN()
+		{
+			makeInfinite();
+		}
+
+		RegionN(const double* pLow, const double* pHigh)
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				m_pLow[cDim] = pLow[cDim];
+				m_pHigh[cDim] = pHigh[cDim];
+			}
+		}
+
+		RegionN(const PointN<D>& low, const PointN<D>& high)
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				m_pLow[cDim] = low.m_pCoords[cDim];
+				m_pHigh[cDim] = high.m_pCoords[cDim];
+			}
+		}
+
+		explicit RegionN(const Region& r)
+		{
+			if (r.m_dimension != D)
+				throw Tools::IllegalArgumentException(
+					"RegionN::RegionN: Region has the wrong number of dimensions."
+				);
+
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				m_pLow[cDim] = r.m_pLow[cDim];
+				m_pHigh[cDim] = r.m_pHigh[cDim];
+			}
+		}
+
+		Region toRegion() const
+		{
+			return Region(m_pLow, m_pHigh, D);
+		}
+
+		uint32_t getDimension() const
+		{
+			return D;
+		}
+
+		void makeInfinite()
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				m_pLow[cDim] = std::numeric_limits<double>::max();
+				m_pHigh[cDim] = -std::numeric_limits<double>::max();
+			}
+		}
+
+		bool intersectsRegion(const RegionN& r) const
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				if (m_pLow[cDim] > r.m_pHigh[cDim] || m_pHigh[cDim] < r.m_pLow[cDim]) return false;
+			}
+
+			return true;
+		}
+
+		bool containsRegion(const RegionN& r) const
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				if (m_pLow[cDim] > r.m_pLow[cDim] || m_pHigh[cDim] < r.m_pHigh[cDim]) return false;
+			}
+
+			return true;
+		}
+
+		bool containsPoint(const PointN<D>& p) const
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				if (m_pLow[cDim] > p.m_pCoords[cDim] || m_pHigh[cDim] < p.m_pCoords[cDim]) return false;
+			}
+
+			return true;
+		}
+
+		void combineRegion(const RegionN& r)
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				m_pLow[cDim] = std::min(m_pLow[cDim], r.m_pLow[cDim]);
+				m_pHigh[cDim] = std::max(m_pHigh[cDim], r.m_pHigh[cDim]);
+			}
+		}
+
+		void combinePoint(const PointN<D>& p)
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				m_pLow[cDim] = std::min(m_pLow[cDim], p.m_pCoords[cDim]);
+				m_pHigh[cDim] = std::max(m_pHigh[cDim], p.m_pCoords[cDim]);
+			}
+		}
+
+		void getCenter(PointN<D>& out) const
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim) out.m_pCoords[cDim] = (m_pLow[cDim] + m_pHigh[cDim]) / 2.0;
+		}
+
+		double getArea() const
+		{
+			double area = 1.0;
+			for (uint32_t cDim = 0; cDim < D; ++cDim) area *= m_pHigh[cDim] - m_pLow[cDim];
+			return area;
+		}
+
+		double getMargin() const
+		{
+			double mul = std::pow(2.0, static_cast<double>(D) - 1.0);
+			double margin = 0.0;
+			for (uint32_t cDim = 0; cDim < D; ++cDim) margin += (m_pHigh[cDim] - m_pLow[cDim]) * mul;
+			return margin;
+		}
+
+		double getMinimumDistanceSq(const RegionN& r) const
+		{
+			return getMinimumDistanceSq(r.m_pLow, r.m_pHigh);
+		}
+
+		double getMinimumDistanceSq(const PointN<D>& p) const
+		{
+			return getMinimumDistanceSq(p.m_pCoords, p.m_pCoords);
+		}
+
+		double getMinimumDistanceSq(const Region& r) const
+		{
+			return getMinimumDistanceSq(r.m_pLow, r.m_pHigh);
+		}
+
+		double getMaximumDistanceSq(const RegionN& r) const
+		{
+			return getMaximumDistanceSq(r.m_pLow, r.m_pHigh);
+		}
+
+		double getMaximumDistanceSq(const Region& r) const
+		{
+			return getMaximumDistanceSq(r.m_pLow, r.m_pHigh);
+		}
+
+		// MinMaxDist from the low corner of this region, taken as a point, to r
+		// [Roussopoulos, Kelley, Vincent 'Nearest Neighbor Queries', SIGMOD 1995].
+		double getMinMaxDistanceSq(const Region& r) const
+		{
+			double rm[D], rM[D];
+			double maxSum = 0.0;
+
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				double p = m_pLow[cDim];
+				double mid = (r.m_pLow[cDim] + r.m_pHigh[cDim]) / 2.0;
+				rm[cDim] = (p <= mid) ? r.m_pLow[cDim] : r.m_pHigh[cDim];
+				rM[cDim] = (p >= mid) ? r.m_pLow[cDim] : r.m_pHigh[cDim];
+				maxSum += (p - rM[cDim]) * (p - rM[cDim]);
+			}
+
+			double ret = std::numeric_limits<double>::max();
+
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				double p = m_pLow[cDim];
+				ret = std::min(ret, maxSum - (p - rM[cDim]) * (p - rM[cDim]) + (p - rm[cDim]) * (p - rm[cDim]));
+			}
+
+			return ret;
+		}
+
+		bool operator==(const RegionN& r) const
+		{
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				if (m_pLow[cDim] != r.m_pLow[cDim] || m_pHigh[cDim] != r.m_pHigh[cDim]) return false;
+			}
+
+			return true;
+		}
+
+		double m_pLow[D];
+		double m_pHigh[D];
+
+	private:
+		double getMinimumDistanceSq(const double* pLow, const double* pHigh) const
+		{
+			double ret = 0.0;
+
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				double x = 0.0;
+				if (pHigh[cDim] < m_pLow[cDim]) x = m_pLow[cDim] - pHigh[cDim];
+				else if (m_pHigh[cDim] < pLow[cDim]) x = pLow[cDim] - m_pHigh[cDim];
+				ret += x * x;
+			}
+
+			return ret;
+		}
+
+		double getMaximumDistanceSq(const double* pLow, const double* pHigh) const
+		{
+			double ret = 0.0;
+
+			for (uint32_t cDim = 0; cDim < D; ++cDim)
+			{
+				double x = std::max(std::abs(m_pLow[cDim] - pHigh[cDim]), std::abs(m_pHigh[cDim] - pLow[cDim]));
+				ret += x * x;
+			}
+
+			return ret;
+		}
+	}; // RegionN
+
+	typedef RegionN<2> Region2;
+	typedef RegionN<3> Region3;
+}
@@ -169,8 +169,24 @@ namespace SpatialIndex
 
     virtual double getDistance() = 0;
     virtual void setDistance(double d) = 0;
+
+		// called by the cascade searches with the mode of the stage that decided the result.
+		virtual void setDecidingMode(int mode) {}
 	}; // IVisitor
 
+	class SIDX_DLL IPairVisitor
+	{
+	public:
+		virtual void visitPair(id_type id1, id_type id2, double distance) = 0;
+		virtual ~IPairVisitor() {}
+
+		// joins deliver their results in batches, passed to visitPair one by one unless overridden.
+		virtual void visitPairs(uint32_t count, const id_type* ids1, const id_type* ids2, const double* distances)
+		{
+			for (uint32_t i = 0; i < count; ++i) visitPair(ids1[i], ids2[i], distances[i]);
+		}
+	}; // IPairVisitor
+
 	class SIDX_DLL IQueryStrategy
 	{
 	public:
@@ -201,6 +217,7 @@ namespace SpatialIndex
 
 		virtual double hausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v) = 0;
 		virtual double mhausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v) =0;
+		virtual double symmetricHausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v) = 0;
 
 		virtual void selectMBRs(const int numMBRs) = 0;
 		virtual void clearMBRs() = 0;
@@ -255,6 +272,8 @@ namespace SpatialIndex
 
 #include "Point.h"
 #include "Region.h"
+#include "PointN.h"
+#include "RegionN.h"
 #include "LineSegment.h"
 #include "TimePoint.h"
 #include "TimeRegion.h"
@@ -35,6 +35,7 @@ private:
     double m_distance;
     int m_traversalCost;
     int m_numDistCals;
+    int m_decidingMode;
 
 public:
 
@@ -55,4 +56,7 @@ public:
 
     double getDistance();
     void setDistance(double d);
+
+    void setDecidingMode(int mode);
+    int getDecidingMode() const { return m_decidingMode; }
 };
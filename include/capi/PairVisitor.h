@@ -0,0 +1,49 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  libsidx - A C API wrapper around libspatialindex
+ * Purpose:  C++ object declarations to implement the pair visitor.
+ * Author:   Howard Butler, hobu.inc@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2009, Howard Butler
+ *
+ * All rights reserved.
+ * 
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2.1 of the License, or (at your option)
+ * any later version.
+
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License 
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ****************************************************************************/
+
+#pragma once
+
+class PairVisitor : public SpatialIndex::IPairVisitor
+{
+private:
+    std::vector<int64_t> m_ids1;
+    std::vector<int64_t> m_ids2;
+    std::vector<double> m_distances;
+
+public:
+
+    PairVisitor();
+    ~PairVisitor();
+
+    uint64_t GetResultCount() const { return m_distances.size(); }
+    std::vector<int64_t>& GetIds1() { return m_ids1; }
+    std::vector<int64_t>& GetIds2() { return m_ids2; }
+    std::vector<double>& GetDistances() { return m_distances; }
+
+    void visitPair(SpatialIndex::id_type id1, SpatialIndex::id_type id2, double distance);
+    void visitPairs(uint32_t count, const SpatialIndex::id_type* ids1, const SpatialIndex::id_type* ids2, const double* distances);
+};
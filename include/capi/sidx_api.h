@@ -100,6 +100,109 @@ SIDX_DLL double Index_Hausdorff(IndexH index,
                                 int* traversal_cost,
                                 int mode);
 
+SIDX_DLL double Index_SymmetricHausdorff(IndexH index,
+                                         IndexH index2,
+                                         uint64_t* id1,
+                                         uint64_t* id2,
+                                         int* traversal_cost,
+                                         int* num_dist_cals,
+                                         int mode);
+
+SIDX_DLL RTError Index_HausdorffTopK(IndexH index,
+                                     IndexH* collection,
+                                     uint32_t nCollection,
+                                     uint32_t k,
+                                     int mode,
+                                     int symmetric,
+                                     uint32_t** positions,
+                                     double** distances,
+                                     uint32_t* nResults,
+                                     int* num_dist_cals);
+
+SIDX_DLL RTError Index_HausdorffRange(IndexH index,
+                                      IndexH* collection,
+                                      uint32_t nCollection,
+                                      double eps,
+                                      int mode,
+                                      int symmetric,
+                                      uint32_t** positions,
+                                      double** distances,
+                                      uint32_t* nResults,
+                                      int* num_dist_cals);
+
+SIDX_DLL RTError Index_HausdorffProgressive(IndexH index,
+                                           IndexH index2,
+                                           double eps,
+                                           double time_limit,
+                                           uint32_t max_dist_cals,
+                                           double* lb,
+                                           double* ub,
+                                           int64_t* id1,
+                                           int64_t* id2,
+                                           int* num_dist_cals);
+
+SIDX_DLL RTError Index_HausdorffCascade(IndexH index,
+                                       IndexH index2,
+                                       double threshold,
+                                       int mode,
+                                       int mean,
+                                       double* distance,
+                                       int* deciding_mode,
+                                       int64_t* id1,
+                                       int64_t* id2,
+                                       int* num_dist_cals);
+
+SIDX_DLL RTError Index_HausdorffWithin(IndexH index,
+                                      IndexH index2,
+                                      double eps,
+                                      int* within,
+                                      int* num_dist_cals);
+
+SIDX_DLL RTError Index_PartialHausdorff(IndexH index,
+                                        IndexH index2,
+                                        uint32_t k,
+                                        double* distance,
+                                        int64_t* id1,
+                                        int64_t* id2,
+                                        int* num_dist_cals);
+
+SIDX_DLL RTError Index_QuantileHausdorff(IndexH index,
+                                         IndexH index2,
+                                         double quantile,
+                                         double* distance,
+                                         int64_t* id1,
+                                         int64_t* id2,
+                                         int* num_dist_cals);
+
+SIDX_DLL RTError Index_ClosestPairs(IndexH index,
+                                   IndexH index2,
+                                   uint32_t k,
+                                   int64_t** ids1,
+                                   int64_t** ids2,
+                                   double** distances,
+                                   uint32_t* nResults);
+
+SIDX_DLL RTError Index_SpatialJoin(IndexH index,
+                                  IndexH index2,
+                                  double distance,
+                                  int64_t** ids1,
+                                  int64_t** ids2,
+                                  double** distances,
+                                  uint64_t* nResults);
+
+SIDX_DLL RTError Index_HausdorffMatrix(IndexH* collection,
+                                       uint32_t nCollection,
+                                       int mode,
+                                       int mean,
+                                       int symmetric,
+                                       double threshold,
+                                       uint32_t threads,
+                                       uint32_t** rows,
+                                       uint32_t** columns,
+                                       double** distances,
+                                       uint64_t* nResults,
+                                       int* num_dist_cals);
+
 SIDX_DLL void Index_SelectMBRs(IndexH index,
                                int numMBRs);
 
@@ -170,12 +273,21 @@ SIDX_DLL uint32_t IndexProperty_GetRegionPoolCapacity(IndexPropertyH iprop);
 SIDX_DLL RTError IndexProperty_SetPointPoolCapacity(IndexPropertyH iprop, uint32_t value);
 SIDX_DLL uint32_t IndexProperty_GetPointPoolCapacity(IndexPropertyH iprop);
 
+SIDX_DLL RTError IndexProperty_SetWorkerThreads(IndexPropertyH iprop, uint32_t value);
+SIDX_DLL uint32_t IndexProperty_GetWorkerThreads(IndexPropertyH iprop);
+
 SIDX_DLL RTError IndexProperty_SetBufferingCapacity(IndexPropertyH iprop, uint32_t value);
 SIDX_DLL uint32_t IndexProperty_GetBufferingCapacity(IndexPropertyH iprop);
 
 SIDX_DLL RTError IndexProperty_SetEnsureTightMBRs(IndexPropertyH iprop, uint32_t value);
 SIDX_DLL uint32_t IndexProperty_GetEnsureTightMBRs(IndexPropertyH iprop);
 
+SIDX_DLL RTError IndexProperty_SetAggregateCounts(IndexPropertyH iprop, uint32_t value);
+SIDX_DLL uint32_t IndexProperty_GetAggregateCounts(IndexPropertyH iprop);
+
+SIDX_DLL RTError IndexProperty_SetCoverSelection(IndexPropertyH iprop, uint32_t value);
+SIDX_DLL uint32_t IndexProperty_GetCoverSelection(IndexPropertyH iprop);
+
 SIDX_DLL RTError IndexProperty_SetOverwrite(IndexPropertyH iprop, uint32_t value);
 SIDX_DLL uint32_t IndexProperty_GetOverwrite(IndexPropertyH iprop);
 
@@ -38,6 +38,7 @@
 #include <capi/ObjVisitor.h>
 #include <capi/IdVisitor.h>
 #include <capi/CountVisitor.h>
+#include <capi/PairVisitor.h>
 #include <capi/BoundsQuery.h>
 #include <capi/LeafQuery.h>
 #include <capi/Error.h>
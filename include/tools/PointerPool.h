@@ -100,6 +100,16 @@ namespace Tools
 		{
 			assert (c >= 0);
 			m_capacity = c;
+
+			// drop the pointers that do not fit any more.
+			while (m_pool.size() > m_capacity)
+			{
+				X* x = m_pool.top(); m_pool.pop();
+				#ifndef NDEBUG
+				--m_pointerCount;
+				#endif
+				delete x;
+			}
 		}
 
 	private:
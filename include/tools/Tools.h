@@ -228,6 +228,16 @@ namespace Tools
 			// store this object in the byte array.
 	};
 
+	class SIDX_DLL IParallelTask
+	{
+	public:
+		virtual ~IParallelTask() {}
+
+		virtual void run(uint32_t index, uint32_t thread) = 0;
+			// process work item index. thread identifies the calling worker
+			// and is smaller than the number of workers.
+	}; // IParallelTask
+
 	class SIDX_DLL IComparable
 	{
 	public:
@@ -414,6 +424,16 @@ namespace Tools
 	#endif
 	}; // ExclusiveLock
 
+	SIDX_DLL uint32_t getNumberOfProcessors();
+
+	SIDX_DLL double getCurrentTime();
+		// wall clock time in milliseconds, for measuring intervals only.
+
+	SIDX_DLL void runParallel(IParallelTask& task, uint32_t count, uint32_t threads);
+		// call task.run for every work item in [0, count) on up to threads workers,
+		// or one per processor if threads is 0. Items are handed out one at a time in
+		// increasing order. Runs on the calling thread if pthreads are not available.
+
 	class SIDX_DLL BufferedFile
 	{
 	public:
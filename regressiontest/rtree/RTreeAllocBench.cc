@@ -0,0 +1,224 @@
+// Spatial Index Library
+//
+// Copyright (C) 2002 Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+// NOTE: Please read README.txt before browsing this code.
+
+// Counts heap allocations done by common Region and query operations, by
+// replacing the global operator new. Builds a random walk of points in a
+// main memory R-tree and prints the allocations per operation and the time.
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// include library header file.
+#include <SpatialIndex.h>
+
+using namespace SpatialIndex;
+using namespace std;
+
+static uint64_t allocations = 0;
+
+void* operator new(size_t size)
+{
+	++allocations;
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == 0) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+class MyVisitor : public IVisitor
+{
+private:
+	double m_distance;
+	int m_numDistCals;
+
+public:
+	size_t m_results;
+
+public:
+	MyVisitor() : m_distance(0.0), m_numDistCals(0), m_results(0) {}
+
+	void visitNode(const INode& n) {}
+	void visitData(const IData& d) { ++m_results; }
+	void visitData(std::vector<const IData*>& v) {}
+
+	double getDistance() { return m_distance; }
+	void setDistance(double d) { m_distance = d; }
+
+	void incNumDistCals(int inc) { m_numDistCals += inc; }
+	int getNumDistCals() { return m_numDistCals; }
+};
+
+static void report(const char* name, uint64_t ops, uint64_t allocs, double ms)
+{
+	cerr << name << ": " << ops << " operations, "
+		<< static_cast<double>(allocs) / ops << " allocations each, "
+		<< ms << " ms" << endl;
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		if (argc != 3)
+		{
+			cerr << "Usage: " << argv[0] << " number_of_points number_of_queries." << endl;
+			return -1;
+		}
+
+		uint32_t numberOfPoints = atoi(argv[1]);
+		uint32_t numberOfQueries = atoi(argv[2]);
+
+		if (numberOfPoints == 0 || numberOfQueries == 0)
+		{
+			cerr << "The number of points and queries must be positive." << endl;
+			return -1;
+		}
+
+		srand48(1);
+
+		IStorageManager* memfile = StorageManager::createNewMemoryStorageManager();
+		IStorageManager* memfile2 = StorageManager::createNewMemoryStorageManager();
+		id_type indexIdentifier, indexIdentifier2;
+		ISpatialIndex* tree = RTree::createNewRTree(*memfile, 0.7, 20, 20, 2, SpatialIndex::RTree::RV_RSTAR, indexIdentifier);
+		ISpatialIndex* tree2 = RTree::createNewRTree(*memfile2, 0.7, 20, 20, 2, SpatialIndex::RTree::RV_RSTAR, indexIdentifier2);
+
+		std::vector<Region> regions;
+		double p[2] = {0.0, 0.0}, q[2] = {0.5, 0.5};
+
+		for (uint32_t i = 0; i < numberOfPoints; ++i)
+		{
+			p[0] += drand48() - 0.5; p[1] += drand48() - 0.5;
+			q[0] += drand48() - 0.5; q[1] += drand48() - 0.5;
+
+			Point pt(p, 2), pt2(q, 2);
+			tree->insertData(0, 0, pt, i);
+			tree2->insertData(0, 0, pt2, i);
+
+			double high[2] = {p[0] + drand48(), p[1] + drand48()};
+			regions.push_back(Region(p, high, 2));
+		}
+
+		uint64_t allocs;
+		double start;
+
+		// Region copies.
+		allocs = allocations;
+		start = Tools::getCurrentTime();
+		double sum = 0.0;
+		for (uint32_t i = 0; i < numberOfQueries; ++i)
+		{
+			Region r(regions[i % numberOfPoints]);
+			sum += r.m_pLow[0];
+		}
+		report("Region copy", numberOfQueries, allocations - allocs, Tools::getCurrentTime() - start);
+
+		// getMBR.
+		allocs = allocations;
+		start = Tools::getCurrentTime();
+		Region mbr;
+		for (uint32_t i = 0; i < numberOfQueries; ++i)
+		{
+			regions[i % numberOfPoints].getMBR(mbr);
+			sum += mbr.m_pLow[0];
+		}
+		report("getMBR", numberOfQueries, allocations - allocs, Tools::getCurrentTime() - start);
+
+		// Hausdorff lower bound between two regions.
+		allocs = allocations;
+		start = Tools::getCurrentTime();
+		for (uint32_t i = 0; i < numberOfQueries; ++i)
+		{
+			sum += regions[i % numberOfPoints].getHausDistLB(regions[(i + 1) % numberOfPoints]);
+		}
+		report("getHausDistLB", numberOfQueries, allocations - allocs, Tools::getCurrentTime() - start);
+
+		// intersection queries.
+		MyVisitor vis;
+		allocs = allocations;
+		start = Tools::getCurrentTime();
+		for (uint32_t i = 0; i < numberOfQueries; ++i)
+		{
+			tree->intersectsWithQuery(regions[i % numberOfPoints], vis);
+		}
+		report("intersectsWithQuery", numberOfQueries, allocations - allocs, Tools::getCurrentTime() - start);
+		cerr << "  results: " << vis.m_results << endl;
+
+		// nearest neighbor queries.
+		allocs = allocations;
+		start = Tools::getCurrentTime();
+		for (uint32_t i = 0; i < numberOfQueries; ++i)
+		{
+			Point pt(regions[i % numberOfPoints].m_pLow, 2);
+			tree->nearestNeighborQuery(10, pt, vis);
+		}
+		report("10NN", numberOfQueries, allocations - allocs, Tools::getCurrentTime() - start);
+
+		// MHD with one nearest neighbor query per point (mode -1).
+		uint64_t id1, id2;
+		allocs = allocations;
+		start = Tools::getCurrentTime();
+		sum += tree->mhausdorff(*tree2, id1, id2, -1, vis);
+		report("MHD mode -1", numberOfPoints, allocations - allocs, Tools::getCurrentTime() - start);
+
+		cerr << "Checksum: " << sum << endl;
+
+		delete tree;
+		delete tree2;
+		delete memfile;
+		delete memfile2;
+	}
+	catch (Tools::Exception& e)
+	{
+		cerr << "******ERROR******" << endl;
+		std::string s = e.what();
+		cerr << s << endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,788 @@
+// Spatial Index Library
+//
+// Copyright (C) 2002 Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+// NOTE: Please read README.txt before browsing this code.
+
+// Checks the Hausdorff distances, the bounds, the joins and the searches of main
+// memory R-trees against a linear scan of the same points. Every mismatch is
+// printed, and the exit status is the number of them.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+// include library header file.
+#include <SpatialIndex.h>
+
+using namespace SpatialIndex;
+using namespace std;
+
+typedef vector<vector<double> > PointSet;
+
+class MyVisitor : public IVisitor
+{
+private:
+	double m_distance;
+	int m_numDistCals;
+
+public:
+	MyVisitor() : m_distance(0.0), m_numDistCals(0) {}
+
+	void visitNode(const INode& n) {}
+	void visitData(const IData& d) {}
+	void visitData(std::vector<const IData*>& v) {}
+
+	double getDistance() { return m_distance; }
+	void setDistance(double d) { m_distance = d; }
+
+	void incNumDistCals(int inc) { m_numDistCals += inc; }
+	int getNumDistCals() { return m_numDistCals; }
+};
+
+static int errors = 0;
+
+static void check(bool b, const string& what)
+{
+	if (! b)
+	{
+		cerr << "FAILED: " << what << endl;
+		++errors;
+	}
+}
+
+// n points of a random walk with unit steps, starting at offset.
+static PointSet randomWalk(uint32_t n, uint32_t dimension, double offset, uint32_t seed)
+{
+	Tools::Random rnd(seed, 0xD31A);
+	PointSet ret;
+	vector<double> p(dimension, offset);
+
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		for (uint32_t cDim = 0; cDim < dimension; ++cDim) p[cDim] += rnd.nextUniformDouble(-0.5, 0.5);
+		ret.push_back(p);
+	}
+
+	return ret;
+}
+
+static ISpatialIndex* createTree(IStorageManager& sm, const PointSet& pts, uint32_t dimension, uint32_t threads, bool bAggregateCounts, id_type& indexIdentifier)
+{
+	Tools::PropertySet ps;
+	Tools::Variant var;
+
+	var.m_varType = Tools::VT_ULONG;
+	var.m_val.ulVal = dimension;
+	ps.setProperty("Dimension", var);
+
+	var.m_val.ulVal = 10;
+	ps.setProperty("IndexCapacity", var);
+	ps.setProperty("LeafCapacity", var);
+
+	var.m_val.ulVal = threads;
+	ps.setProperty("WorkerThreads", var);
+
+	var.m_varType = Tools::VT_BOOL;
+	var.m_val.blVal = bAggregateCounts;
+	ps.setProperty("AggregateCounts", var);
+
+	ISpatialIndex* tree = RTree::returnRTree(sm, ps);
+	indexIdentifier = ps.getProperty("IndexIdentifier").m_val.llVal;
+
+	for (uint32_t i = 0; i < pts.size(); ++i)
+	{
+		Region r(&pts[i][0], &pts[i][0], dimension);
+		tree->insertData(0, 0, r, i);
+	}
+
+	return tree;
+}
+
+static ISpatialIndex* createTree(IStorageManager& sm, const PointSet& pts, uint32_t dimension, uint32_t threads)
+{
+	id_type indexIdentifier;
+	return createTree(sm, pts, dimension, threads, false, indexIdentifier);
+}
+
+static double getDistance(const vector<double>& a, const vector<double>& b)
+{
+	double ret = 0.0;
+	for (uint32_t cDim = 0; cDim < a.size(); ++cDim) ret += (a[cDim] - b[cDim]) * (a[cDim] - b[cDim]);
+	return sqrt(ret);
+}
+
+// the nearest neighbor distance in b of every point of a, DBL_MAX if b is empty.
+static vector<double> getNearestDistances(const PointSet& a, const PointSet& b)
+{
+	vector<double> ret(a.size(), numeric_limits<double>::max());
+
+	for (uint32_t i = 0; i < a.size(); ++i)
+	{
+		for (uint32_t j = 0; j < b.size(); ++j) ret[i] = min(ret[i], getDistance(a[i], b[j]));
+	}
+
+	return ret;
+}
+
+static double bruteHausdorff(const PointSet& a, const PointSet& b)
+{
+	vector<double> nearest = getNearestDistances(a, b);
+	double ret = 0.0;
+	for (uint32_t i = 0; i < nearest.size(); ++i) ret = max(ret, nearest[i]);
+	return ret;
+}
+
+static double bruteMean(const PointSet& a, const PointSet& b)
+{
+	if (a.empty()) return 0.0;
+	if (b.empty()) return numeric_limits<double>::max();
+
+	vector<double> nearest = getNearestDistances(a, b);
+	double sum = 0.0;
+	for (uint32_t i = 0; i < nearest.size(); ++i) sum += nearest[i];
+	return sum / nearest.size();
+}
+
+static bool isClose(double a, double b)
+{
+	if (a == b) return true;
+	return abs(a - b) <= 1e-9 * max(1.0, max(abs(a), abs(b)));
+}
+
+// mode 2 of mhausdorff sums in single precision.
+static bool isBelow(double bound, double exact)
+{
+	return bound <= exact + 1e-5 * max(1.0, exact);
+}
+
+static string toString(int i)
+{
+	ostringstream os;
+	os << i;
+	return os.str();
+}
+
+// Every exact mode against the linear scan, and every bound against the exact distance.
+static void checkModes(const PointSet& a, const PointSet& b, uint32_t dimension, const string& what)
+{
+	IStorageManager* sm1 = StorageManager::createNewMemoryStorageManager();
+	IStorageManager* sm2 = StorageManager::createNewMemoryStorageManager();
+	ISpatialIndex* t1 = createTree(*sm1, a, dimension, 2);
+	ISpatialIndex* t2 = createTree(*sm2, b, dimension, 2);
+
+	double h = bruteHausdorff(a, b);
+	double mh = bruteMean(a, b);
+	double sh = max(h, bruteHausdorff(b, a));
+	bool bPoints = ! a.empty() && ! b.empty();
+	uint64_t id1 = 0, id2 = 0;
+	MyVisitor vis;
+
+	for (int mode = -4; mode <= 0; ++mode)
+	{
+		string m = " mode " + toString(mode) + ", " + what;
+
+		double d = t1->hausdorff(*t2, id1, id2, mode, vis);
+		check(isClose(d, h), "hausdorff" + m);
+		if (bPoints) check(id1 < a.size() && id2 < b.size() && isClose(getDistance(a[id1], b[id2]), h), "hausdorff pair" + m);
+
+		d = t1->symmetricHausdorff(*t2, id1, id2, mode, vis);
+		check(isClose(d, sh), "symmetricHausdorff" + m);
+		if (bPoints) check(id1 < a.size() && id2 < b.size() && isClose(getDistance(a[id1], b[id2]), sh), "symmetricHausdorff pair" + m);
+
+		if (mode < -2) continue;
+
+		d = t1->mhausdorff(*t2, id1, id2, mode, vis);
+		check(isClose(d, mh), "mhausdorff" + m);
+	}
+
+	// the bounds, without and with the selected MBRs.
+	for (uint32_t cSelect = 0; cSelect < 2; ++cSelect)
+	{
+		if (cSelect == 1)
+		{
+			t1->selectMBRs(4);
+			t2->selectMBRs(4);
+		}
+
+		for (int mode = 1; mode <= 3; ++mode)
+		{
+			string m = " mode " + toString(mode) + ((cSelect == 0) ? "" : " with selected MBRs") + ", " + what;
+			check(isBelow(t1->hausdorff(*t2, id1, id2, mode, vis), h), "hausdorff bound" + m);
+			check(isBelow(t1->mhausdorff(*t2, id1, id2, mode, vis), mh), "mhausdorff bound" + m);
+			check(isBelow(t1->symmetricHausdorff(*t2, id1, id2, mode, vis), sh), "symmetricHausdorff bound" + m);
+		}
+	}
+
+	delete t1;
+	delete t2;
+	delete sm1;
+	delete sm2;
+}
+
+// A tree without points, or with a single one, on either side.
+static void checkEmptyTrees()
+{
+	PointSet none;
+	PointSet one = randomWalk(1, 2, 0.0, 1);
+	PointSet many = randomWalk(50, 2, 3.0, 2);
+
+	const PointSet* sets[] = {&none, &one, &many};
+	const char* names[] = {"empty", "single", "50 points"};
+
+	for (uint32_t a = 0; a < 3; ++a)
+	{
+		for (uint32_t b = 0; b < 3; ++b)
+		{
+			checkModes(*sets[a], *sets[b], 2, string(names[a]) + " against " + names[b]);
+		}
+	}
+}
+
+static void checkRandomTrees()
+{
+	checkModes(randomWalk(400, 2, 0.0, 3), randomWalk(300, 2, 2.0, 4), 2, "400 against 300 points");
+	checkModes(randomWalk(300, 2, 2.0, 4), randomWalk(400, 2, 0.0, 3), 2, "300 against 400 points");
+	checkModes(randomWalk(250, 3, 0.0, 5), randomWalk(250, 3, 0.5, 6), 3, "3 dimensions");
+}
+
+// The bounds stay below the exact distances while points are inserted and deleted.
+static void checkUpdates()
+{
+	PointSet a = randomWalk(400, 2, 0.0, 7);
+	PointSet b = randomWalk(300, 2, 1.0, 8);
+	PointSet extra = randomWalk(100, 2, -1.0, 9);
+
+	IStorageManager* sm1 = StorageManager::createNewMemoryStorageManager();
+	IStorageManager* sm2 = StorageManager::createNewMemoryStorageManager();
+	ISpatialIndex* t1 = createTree(*sm1, a, 2, 2);
+	ISpatialIndex* t2 = createTree(*sm2, b, 2, 2);
+	t1->selectMBRs(8);
+	t2->selectMBRs(8);
+
+	vector<bool> alive(a.size(), true);
+	uint64_t id1, id2;
+	MyVisitor vis;
+
+	// the exact mode fills the point list, so that deletes take the incremental path.
+	t1->hausdorff(*t2, id1, id2, 0, vis);
+
+	for (uint32_t cStep = 0; cStep < 250; ++cStep)
+	{
+		if (cStep < 150)
+		{
+			uint32_t i = (cStep * 7919) % 400;
+			if (! alive[i]) continue;
+
+			Region r(&a[i][0], &a[i][0], 2);
+			check(t1->deleteData(r, i), "deleteData " + toString(i));
+			alive[i] = false;
+		}
+		else
+		{
+			uint32_t i = a.size();
+			a.push_back(extra[cStep - 150]);
+			alive.push_back(true);
+
+			Region r(&a[i][0], &a[i][0], 2);
+			t1->insertData(0, 0, r, i);
+		}
+
+		if (cStep % 25 != 24) continue;
+
+		PointSet current;
+		for (uint32_t i = 0; i < a.size(); ++i) if (alive[i]) current.push_back(a[i]);
+
+		double h = bruteHausdorff(current, b);
+		double mh = bruteMean(current, b);
+		string what = " after " + toString(cStep + 1) + " updates";
+
+		check(isClose(t1->hausdorff(*t2, id1, id2, 0, vis), h), "hausdorff mode 0" + what);
+		check(isClose(t1->mhausdorff(*t2, id1, id2, 0, vis), mh), "mhausdorff mode 0" + what);
+
+		for (int mode = 1; mode <= 3; ++mode)
+		{
+			check(isBelow(t1->hausdorff(*t2, id1, id2, mode, vis), h), "hausdorff bound mode " + toString(mode) + what);
+			check(isBelow(t1->mhausdorff(*t2, id1, id2, mode, vis), mh), "mhausdorff bound mode " + toString(mode) + what);
+		}
+	}
+
+	delete t1;
+	delete t2;
+	delete sm1;
+	delete sm2;
+}
+
+// The selected MBRs are stored with the header and used again by a reloaded tree.
+static void checkPersistedSummary()
+{
+	PointSet a = randomWalk(300, 2, 0.0, 10);
+	PointSet b = randomWalk(300, 2, 1.5, 11);
+
+	IStorageManager* sm1 = StorageManager::createNewMemoryStorageManager();
+	IStorageManager* sm2 = StorageManager::createNewMemoryStorageManager();
+	id_type indexIdentifier;
+	ISpatialIndex* t1 = createTree(*sm1, a, 2, 2, false, indexIdentifier);
+	ISpatialIndex* t2 = createTree(*sm2, b, 2, 2);
+	t1->selectMBRs(6);
+	t2->selectMBRs(6);
+
+	uint64_t id1, id2;
+	MyVisitor vis;
+	double h = t1->hausdorff(*t2, id1, id2, 2, vis);
+	double mh = t1->mhausdorff(*t2, id1, id2, 2, vis);
+	// so that a tree reloaded without them would give a different bound.
+	check(mh > t1->mhausdorff(*t2, id1, id2, 1, vis), "the selected MBRs tighten the mhausdorff bound");
+
+	delete t1;
+	t1 = RTree::loadRTree(*sm1, indexIdentifier);
+
+	check(isClose(t1->hausdorff(*t2, id1, id2, 2, vis), h), "hausdorff mode 2 after reloading");
+	check(isClose(t1->mhausdorff(*t2, id1, id2, 2, vis), mh), "mhausdorff mode 2 after reloading");
+	check(isClose(t1->hausdorff(*t2, id1, id2, 0, vis), bruteHausdorff(a, b)), "hausdorff mode 0 after reloading");
+
+	delete t1;
+	delete t2;
+	delete sm1;
+	delete sm2;
+}
+
+static uint64_t bruteCount(const PointSet& pts, const vector<bool>& alive, const Region& r)
+{
+	uint64_t ret = 0;
+
+	for (uint32_t i = 0; i < pts.size(); ++i)
+	{
+		if (alive[i] && r.containsPoint(Point(&pts[i][0], r.getDimension()))) ++ret;
+	}
+
+	return ret;
+}
+
+// countQuery with and without the aggregate counts of the index entries.
+static void checkCounts()
+{
+	PointSet a = randomWalk(500, 2, 0.0, 12);
+	vector<bool> alive(a.size(), true);
+	Tools::Random rnd(13, 0xD31A);
+	MyVisitor vis;
+
+	IStorageManager* sm1 = StorageManager::createNewMemoryStorageManager();
+	IStorageManager* sm2 = StorageManager::createNewMemoryStorageManager();
+	IStorageManager* sm3 = StorageManager::createNewMemoryStorageManager();
+	id_type indexIdentifier;
+	ISpatialIndex* t1 = createTree(*sm1, a, 2, 1, true, indexIdentifier);
+	ISpatialIndex* t2 = createTree(*sm2, a, 2, 1, false, indexIdentifier);
+	ISpatialIndex* empty = createTree(*sm3, PointSet(), 2, 1, true, indexIdentifier);
+
+	for (uint32_t cRound = 0; cRound < 2; ++cRound)
+	{
+		if (cRound == 1)
+		{
+			for (uint32_t i = 0; i < a.size(); i += 3)
+			{
+				Region r(&a[i][0], &a[i][0], 2);
+				t1->deleteData(r, i);
+				t2->deleteData(r, i);
+				alive[i] = false;
+			}
+		}
+
+		for (uint32_t cQuery = 0; cQuery < 50; ++cQuery)
+		{
+			double low[2], high[2];
+			for (uint32_t cDim = 0; cDim < 2; ++cDim)
+			{
+				low[cDim] = rnd.nextUniformDouble(-10.0, 10.0);
+				high[cDim] = low[cDim] + rnd.nextUniformDouble(0.0, 10.0);
+			}
+			Region r(low, high, 2);
+
+			uint64_t count = bruteCount(a, alive, r);
+			string what = "countQuery " + toString(cQuery) + ((cRound == 0) ? "" : " after deletes");
+			check(RTree::countQuery(*t1, r, vis) == count, what + " with aggregate counts");
+			check(RTree::countQuery(*t2, r, vis) == count, what);
+			check(RTree::countQuery(*empty, r, vis) == 0, what + " on an empty tree");
+		}
+	}
+
+	delete t1;
+	delete t2;
+	delete empty;
+	delete sm1;
+	delete sm2;
+	delete sm3;
+}
+
+class MyPairVisitor : public IPairVisitor
+{
+public:
+	vector<pair<pair<id_type, id_type>, double> > m_pairs;
+
+	void visitPair(id_type id1, id_type id2, double distance)
+	{
+		m_pairs.push_back(make_pair(make_pair(id1, id2), distance));
+	}
+};
+
+static bool isIndex(id_type id, const PointSet& pts)
+{
+	return id >= 0 && static_cast<uint64_t>(id) < pts.size();
+}
+
+static void checkSpatialJoin(ISpatialIndex& t1, ISpatialIndex& t2, const PointSet& a, const PointSet& b, double distance, const string& what)
+{
+	MyPairVisitor pv;
+	MyVisitor vis;
+	RTree::spatialJoinQuery(t1, t2, distance, pv, vis);
+	sort(pv.m_pairs.begin(), pv.m_pairs.end());
+
+	vector<pair<id_type, id_type> > pairs;
+	for (uint32_t i = 0; i < a.size(); ++i)
+	{
+		for (uint32_t j = 0; j < b.size(); ++j)
+		{
+			if (getDistance(a[i], b[j]) <= distance) pairs.push_back(make_pair(id_type(i), id_type(j)));
+		}
+	}
+
+	check(pv.m_pairs.size() == pairs.size(), "spatialJoinQuery pair count, " + what);
+
+	for (uint32_t i = 0; i < min(pv.m_pairs.size(), pairs.size()); ++i)
+	{
+		const pair<id_type, id_type>& p = pv.m_pairs[i].first;
+		check(p == pairs[i] && isClose(pv.m_pairs[i].second, getDistance(a[p.first], b[p.second])), "spatialJoinQuery pair " + toString(i) + ", " + what);
+	}
+}
+
+// The joins against a linear scan of all pairs.
+static void checkJoins()
+{
+	PointSet none;
+	PointSet one = randomWalk(1, 2, 0.0, 14);
+	PointSet a = randomWalk(300, 2, 0.0, 15);
+	PointSet b = randomWalk(250, 2, 0.5, 16);
+
+	const PointSet* sets[] = {&none, &one, &a, &b};
+	const char* names[] = {"empty", "single", "300 points", "250 points"};
+
+	for (uint32_t threads = 1; threads <= 4; threads += 3)
+	{
+		for (uint32_t cA = 0; cA < 4; ++cA)
+		{
+			for (uint32_t cB = 0; cB < 4; ++cB)
+			{
+				const PointSet& pa = *sets[cA];
+				const PointSet& pb = *sets[cB];
+				string what = string(names[cA]) + " against " + names[cB] + ", " + toString(threads) + " threads";
+
+				IStorageManager* sm1 = StorageManager::createNewMemoryStorageManager();
+				IStorageManager* sm2 = StorageManager::createNewMemoryStorageManager();
+				ISpatialIndex* t1 = createTree(*sm1, pa, 2, threads);
+				ISpatialIndex* t2 = createTree(*sm2, pb, 2, threads);
+				MyVisitor vis;
+
+				checkSpatialJoin(*t1, *t2, pa, pb, 0.0, what);
+				checkSpatialJoin(*t1, *t2, pa, pb, 0.3, what);
+				if (cA == cB) checkSpatialJoin(*t1, *t1, pa, pa, 0.0, "self join, " + what);
+
+				if (threads == 1)
+				{
+					MyPairVisitor pv;
+					RTree::allNearestNeighborJoin(*t1, *t2, pv, vis);
+					vector<double> nearest = getNearestDistances(pa, pb);
+
+					check(pv.m_pairs.size() == ((pb.empty()) ? 0 : pa.size()), "allNearestNeighborJoin pair count, " + what);
+					for (uint32_t i = 0; i < pv.m_pairs.size(); ++i)
+					{
+						const pair<id_type, id_type>& p = pv.m_pairs[i].first;
+						check(isIndex(p.first, pa) && isIndex(p.second, pb) && isClose(pv.m_pairs[i].second, nearest[p.first]) && isClose(pv.m_pairs[i].second, getDistance(pa[p.first], pb[p.second])), "allNearestNeighborJoin pair " + toString(i) + ", " + what);
+					}
+
+					vector<double> all;
+					for (uint32_t i = 0; i < pa.size(); ++i)
+					{
+						for (uint32_t j = 0; j < pb.size(); ++j) all.push_back(getDistance(pa[i], pb[j]));
+					}
+					sort(all.begin(), all.end());
+
+					MyPairVisitor closest;
+					RTree::closestPairsQuery(*t1, *t2, 20, closest, vis);
+
+					check(closest.m_pairs.size() == min<size_t>(20, all.size()), "closestPairsQuery pair count, " + what);
+					for (uint32_t i = 0; i < min(closest.m_pairs.size(), all.size()); ++i)
+					{
+						const pair<id_type, id_type>& p = closest.m_pairs[i].first;
+						check(isIndex(p.first, pa) && isIndex(p.second, pb) && isClose(closest.m_pairs[i].second, all[i]) && isClose(all[i], getDistance(pa[p.first], pb[p.second])), "closestPairsQuery pair " + toString(i) + ", " + what);
+					}
+				}
+
+				delete t1;
+				delete t2;
+				delete sm1;
+				delete sm2;
+			}
+		}
+	}
+}
+
+// the k-th largest of the nearest neighbor distances.
+static double brutePartial(const PointSet& a, const PointSet& b, uint32_t k)
+{
+	if (a.empty()) return 0.0;
+	if (b.empty()) return numeric_limits<double>::max();
+
+	vector<double> nearest = getNearestDistances(a, b);
+	sort(nearest.begin(), nearest.end());
+	return nearest[nearest.size() - min<size_t>(k, nearest.size())];
+}
+
+// The searches of a collection of trees and the distances built on the exact modes.
+static void checkSearches()
+{
+	PointSet q = randomWalk(120, 2, 0.0, 17);
+	vector<PointSet> items;
+	items.push_back(PointSet());
+	items.push_back(randomWalk(1, 2, 0.5, 18));
+	for (uint32_t i = 0; i < 6; ++i) items.push_back(randomWalk(80 + 20 * i, 2, 0.4 * i, 19 + i));
+
+	IStorageManager* smq = StorageManager::createNewMemoryStorageManager();
+	ISpatialIndex* query = createTree(*smq, q, 2, 2);
+	query->selectMBRs(4);
+
+	vector<IStorageManager*> sms;
+	vector<ISpatialIndex*> collection;
+	vector<double> h, sh, hr, mh;
+
+	for (uint32_t i = 0; i < items.size(); ++i)
+	{
+		sms.push_back(StorageManager::createNewMemoryStorageManager());
+		collection.push_back(createTree(*sms.back(), items[i], 2, 2));
+		if (i % 2 == 0) collection.back()->selectMBRs(4);
+
+		h.push_back(bruteHausdorff(q, items[i]));
+		hr.push_back(bruteHausdorff(items[i], q));
+		sh.push_back(max(h.back(), hr.back()));
+		mh.push_back(bruteMean(items[i], q));
+	}
+
+	MyVisitor vis;
+	uint64_t id1, id2;
+
+	for (int mode = -2; mode <= 0; mode += 2)
+	{
+		for (uint32_t cSymmetric = 0; cSymmetric < 2; ++cSymmetric)
+		{
+			const vector<double>& d = (cSymmetric == 0) ? h : sh;
+			string what = " mode " + toString(mode) + ((cSymmetric == 0) ? "" : " symmetric");
+
+			vector<double> sorted(d);
+			sort(sorted.begin(), sorted.end());
+
+			for (uint32_t k = 1; k <= items.size(); k += 3)
+			{
+				vector<pair<double, uint32_t> > results;
+				RTree::hausdorffTopK(*query, collection, k, mode, cSymmetric == 1, results, vis);
+
+				check(results.size() == k, "hausdorffTopK size, k " + toString(k) + what);
+				for (uint32_t i = 0; i < min<size_t>(k, results.size()); ++i)
+				{
+					check(isClose(results[i].first, sorted[i]) && isClose(results[i].first, d[results[i].second]), "hausdorffTopK result " + toString(i) + ", k " + toString(k) + what);
+				}
+			}
+
+			for (uint32_t cEps = 0; cEps < 3; ++cEps)
+			{
+				double eps = sorted[2 * cEps + 1];
+				vector<pair<double, uint32_t> > results;
+				RTree::hausdorffRange(*query, collection, eps, mode, cSymmetric == 1, results, vis);
+
+				vector<uint32_t> found, expected;
+				for (uint32_t i = 0; i < results.size(); ++i) found.push_back(results[i].second);
+				for (uint32_t i = 0; i < d.size(); ++i) if (d[i] <= eps) expected.push_back(i);
+				sort(found.begin(), found.end());
+
+				check(found == expected, "hausdorffRange, eps " + toString(cEps) + what);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < collection.size(); ++i)
+	{
+		ISpatialIndex& item = *(collection[i]);
+		string what = ", item " + toString(i);
+
+		// h(item, query) from here on.
+		RTree::HausdorffBounds b;
+		RTree::hausdorffProgressive(item, *query, 0.0, 0.0, 0, b, vis);
+		check(isClose(b.m_lb, hr[i]) && isClose(b.m_ub, hr[i]), "hausdorffProgressive to the end" + what);
+
+		for (uint32_t maxDistCals = 1; maxDistCals <= 64; maxDistCals *= 8)
+		{
+			RTree::hausdorffProgressive(item, *query, 0.0, 0.0, maxDistCals, b, vis);
+			check(isBelow(b.m_lb, hr[i]) && isBelow(hr[i], b.m_ub), "hausdorffProgressive with " + toString(maxDistCals) + " distances" + what);
+		}
+
+		for (uint32_t cMean = 0; cMean < 2; ++cMean)
+		{
+			double exact = (cMean == 0) ? hr[i] : mh[i];
+			double thresholds[] = {0.5 * exact, 0.9 * exact, 1.1 * exact, 2.0 * exact + 1.0};
+
+			for (uint32_t cThreshold = 0; cThreshold < 4; ++cThreshold)
+			{
+				double threshold = thresholds[cThreshold];
+				if (threshold == exact) continue;
+
+				double d = RTree::hausdorffCascade(item, *query, threshold, 0, cMean == 1, id1, id2, vis);
+				check((d <= threshold) == (exact <= threshold), string("hausdorffCascade") + ((cMean == 0) ? "" : " mean") + ", threshold " + toString(cThreshold) + what);
+
+				if (cMean == 0) check(RTree::hausdorffWithin(item, *query, threshold, vis) == (exact <= threshold), "hausdorffWithin, eps " + toString(cThreshold) + what);
+			}
+		}
+
+		uint32_t ks[] = {1, 2, 5, static_cast<uint32_t>(items[i].size())};
+		for (uint32_t cK = 0; cK < 4; ++cK)
+		{
+			if (ks[cK] == 0) continue;
+			double d = RTree::partialHausdorff(item, *query, ks[cK], id1, id2, vis);
+			check(isClose(d, brutePartial(items[i], q, ks[cK])), "partialHausdorff, k " + toString(ks[cK]) + what);
+		}
+
+		double quantiles[] = {0.1, 0.5, 0.9, 1.0};
+		for (uint32_t cQuantile = 0; cQuantile < 4; ++cQuantile)
+		{
+			// the ceil(quantile * n)-th smallest distance.
+			uint32_t n = items[i].size();
+			uint32_t rank = max<uint32_t>(1, static_cast<uint32_t>(ceil(quantiles[cQuantile] * n)));
+			double d = RTree::quantileHausdorff(item, *query, quantiles[cQuantile], id1, id2, vis);
+			check(isClose(d, brutePartial(items[i], q, n - min(rank, n) + 1)), "quantileHausdorff " + toString(cQuantile) + what);
+		}
+	}
+
+	vector<ISpatialIndex*> selected;
+	for (uint32_t i = 2; i < collection.size(); i += 2) selected.push_back(collection[i]);
+	double tightness = RTree::coverTightness(selected, 10, 0, vis);
+	check(tightness >= 0.0 && tightness <= 1.0 + 1e-9, "coverTightness in [0, 1]");
+
+	for (uint32_t i = 0; i < collection.size(); ++i)
+	{
+		delete collection[i];
+		delete sms[i];
+	}
+	delete query;
+	delete smq;
+}
+
+// All pairs of a collection, with every engine and option of hausdorffMatrix.
+static void checkMatrix()
+{
+	vector<PointSet> items;
+	items.push_back(PointSet());
+	items.push_back(randomWalk(1, 2, 0.0, 30));
+	for (uint32_t i = 0; i < 4; ++i) items.push_back(randomWalk(60 + 30 * i, 2, 0.5 * i, 31 + i));
+
+	vector<IStorageManager*> sms;
+	vector<ISpatialIndex*> collection;
+
+	for (uint32_t i = 0; i < items.size(); ++i)
+	{
+		sms.push_back(StorageManager::createNewMemoryStorageManager());
+		collection.push_back(createTree(*sms.back(), items[i], 2, 1));
+	}
+
+	int modes[] = {0, -3, -4, 0};
+	MyVisitor vis;
+
+	for (uint32_t cMode = 0; cMode < 4; ++cMode)
+	{
+		bool bMean = (cMode == 3);
+
+		for (uint32_t cSymmetric = 0; cSymmetric < 2; ++cSymmetric)
+		{
+			double thresholds[] = {numeric_limits<double>::max(), 1.0};
+
+			for (uint32_t cThreshold = 0; cThreshold < 2; ++cThreshold)
+			{
+				vector<RTree::HausdorffMatrixEntry> expected;
+
+				for (uint32_t row = 0; row < items.size(); ++row)
+				{
+					for (uint32_t column = (cSymmetric == 0) ? 0 : row + 1; column < items.size(); ++column)
+					{
+						if (row == column || items[row].empty() || items[column].empty()) continue;
+
+						double d = (bMean) ? bruteMean(items[row], items[column]) : bruteHausdorff(items[row], items[column]);
+						if (cSymmetric == 1) d = max(d, (bMean) ? bruteMean(items[column], items[row]) : bruteHausdorff(items[column], items[row]));
+						if (d <= thresholds[cThreshold]) expected.push_back(RTree::HausdorffMatrixEntry(row, column, d));
+					}
+				}
+
+				vector<RTree::HausdorffMatrixEntry> results;
+				RTree::hausdorffMatrix(collection, modes[cMode], bMean, cSymmetric == 1, thresholds[cThreshold], 2, results, vis);
+
+				string what = " mode " + toString(modes[cMode]) + ((bMean) ? " mean" : "") + ((cSymmetric == 0) ? "" : " symmetric") + ", threshold " + toString(cThreshold);
+				check(results.size() == expected.size(), "hausdorffMatrix size," + what);
+
+				for (uint32_t i = 0; i < min(results.size(), expected.size()); ++i)
+				{
+					check(results[i].m_row == expected[i].m_row && results[i].m_column == expected[i].m_column && isClose(results[i].m_dist, expected[i].m_dist), "hausdorffMatrix entry " + toString(i) + "," + what);
+				}
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < collection.size(); ++i)
+	{
+		delete collection[i];
+		delete sms[i];
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		checkEmptyTrees();
+		checkRandomTrees();
+		checkUpdates();
+		checkPersistedSummary();
+		checkCounts();
+		checkJoins();
+		checkSearches();
+		checkMatrix();
+	}
+	catch (Tools::Exception& e)
+	{
+		cerr << "******ERROR******" << endl;
+		std::string s = e.what();
+		cerr << s << endl;
+		return -1;
+	}
+	catch (...)
+	{
+		cerr << "******ERROR******" << endl;
+		cerr << "other exception" << endl;
+		return -1;
+	}
+
+	if (errors == 0) cerr << "All checks passed." << endl;
+	return errors;
+}
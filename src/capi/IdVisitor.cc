@@ -31,6 +31,7 @@ IdVisitor::IdVisitor(): nResults(0)
 {
 	this->m_traversalCost = 0;
 	this->m_numDistCals = 0;
+	this->m_decidingMode = 0;
 }
 
 IdVisitor::~IdVisitor()
@@ -76,3 +77,7 @@ void IdVisitor::incNumDistCals(int inc) {
 int IdVisitor::getNumDistCals() {
 	return m_numDistCals;
 }
+
+void IdVisitor::setDecidingMode(int mode) {
+	m_decidingMode = mode;
+}
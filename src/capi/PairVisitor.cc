@@ -0,0 +1,51 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:	 libsidx - A C API wrapper around libspatialindex
+ * Purpose:	 C++ objects to implement the pair visitor.
+ * Author:	 Howard Butler, hobu.inc@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2009, Howard Butler
+ *
+ * All rights reserved.
+ * 
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2.1 of the License, or (at your option)
+ * any later version.
+
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License 
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA	02110-1301	USA
+ ****************************************************************************/
+
+#include "sidx_impl.h"
+
+PairVisitor::PairVisitor()
+{
+}
+
+PairVisitor::~PairVisitor()
+{
+
+}
+
+void PairVisitor::visitPair(SpatialIndex::id_type id1, SpatialIndex::id_type id2, double distance)
+{
+	m_ids1.push_back(id1);
+	m_ids2.push_back(id2);
+	m_distances.push_back(distance);
+}
+
+void PairVisitor::visitPairs(uint32_t count, const SpatialIndex::id_type* ids1, const SpatialIndex::id_type* ids2, const double* distances)
+{
+	m_ids1.insert(m_ids1.end(), ids1, ids1 + count);
+	m_ids2.insert(m_ids2.end(), ids2, ids2 + count);
+	m_distances.insert(m_distances.end(), distances, distances + count);
+}
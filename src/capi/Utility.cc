@@ -74,6 +74,14 @@ Tools::PropertySet* GetDefaults()
 	var.m_varType = Tools::VT_BOOL;
 	var.m_val.bVal = true;
 	ps->setProperty("EnsureTightMBRs", var);
+
+	var.m_varType = Tools::VT_BOOL;
+	var.m_val.blVal = false;
+	ps->setProperty("AggregateCounts", var);
+
+	var.m_varType = Tools::VT_LONG;
+	var.m_val.lVal = SpatialIndex::RTree::CS_AREA;
+	ps->setProperty("CoverSelection", var);
 	
 	var.m_varType = Tools::VT_ULONG;
 	var.m_val.ulVal = 100;
@@ -91,6 +99,10 @@ Tools::PropertySet* GetDefaults()
 	var.m_val.ulVal = 500;
 	ps->setProperty("PointPoolCapacity", var);
 
+	var.m_varType = Tools::VT_ULONG;
+	var.m_val.ulVal = 1;
+	ps->setProperty("WorkerThreads", var);
+
 	// horizon for TPRTree
 	var.m_varType = Tools::VT_DOUBLE;
 	var.m_val.dblVal = 20.0;
@@ -393,10 +393,18 @@ SIDX_C_DLL RTError Index_Intersects_count(	  IndexH index,
 	CountVisitor* visitor = new CountVisitor;
 	try {
 		SpatialIndex::Region* r = new SpatialIndex::Region(pdMin, pdMax, nDimension);
-		idx->index().intersectsWithQuery(	*r, 
-				*visitor);
 
-		*nResults = visitor->GetResultCount();
+		if (idx->GetIndexType() == RT_RTree)
+		{
+			*nResults = SpatialIndex::RTree::countQuery(idx->index(), *r, *visitor);
+		}
+		else
+		{
+			idx->index().intersectsWithQuery(	*r, 
+					*visitor);
+
+			*nResults = visitor->GetResultCount();
+		}
 
 		delete r;
 		delete visitor;
@@ -549,124 +557,740 @@ SIDX_C_DLL double Index_Hausdorff(IndexH index,
     int* num_dist_cals,
 		int mode)
 {
-	VALIDATE_POINTER1(index, "Index_Hausdorff", RT_Failure);	 
-	VALIDATE_POINTER1(index2, "Index_Hausdorff", RT_Failure);
+	VALIDATE_POINTER1(index, "Index_Hausdorff", RT_Failure);	 
+	VALIDATE_POINTER1(index2, "Index_Hausdorff", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+	Index* idx2 = static_cast<Index*>(index2);
+
+	IdVisitor* visitor = 0;
+	//if (mode == 0) {
+		visitor = new IdVisitor;
+	//}
+
+	try {	 
+
+		double h = idx->index().hausdorff(idx2->index(),
+				*id1,
+				*id2,
+				mode,
+				*visitor);
+
+    *num_dist_cals = visitor->getNumDistCals();
+
+		//if (mode == 0) {
+			*traversal_cost = visitor->getTraversalCost();
+			delete visitor;
+		//}
+		return h;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_Hausdorff");
+		if (mode == 0) {
+			delete visitor;
+		}
+		return 0;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_Hausdorff");
+		if (mode == 0) {
+			delete visitor;
+		}
+		return 0;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_Hausdorff");
+		if (mode == 0) {
+			delete visitor;
+		}
+		return 0;		  
+	}
+	return 0;
+}
+
+SIDX_C_DLL double Index_MHausdorff(IndexH index, 
+		IndexH index2,
+		uint64_t* id1,
+		uint64_t* id2,
+		int* traversal_cost,
+    int* num_dist_cals,
+		int mode)
+{
+	VALIDATE_POINTER1(index, "Index_MHausdorff", RT_Failure);
+	VALIDATE_POINTER1(index2, "Index_MHausdorff", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+	Index* idx2 = static_cast<Index*>(index2);
+
+	IdVisitor* visitor = 0;
+	//if (mode == 0) {
+		visitor = new IdVisitor;
+	//}
+
+	try {	 
+
+		double h = idx->index().mhausdorff(idx2->index(),
+				*id1,
+				*id2,
+				mode,
+				*visitor);
+
+    *num_dist_cals = visitor->getNumDistCals();
+
+		//if (mode == 0) {
+			*traversal_cost = visitor->getTraversalCost();
+			delete visitor;
+		//}
+		return h;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_MHausdorff");
+		if (mode == 0) {
+			delete visitor;
+		}
+		return 0;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_MHausdorff");
+		if (mode == 0) {
+			delete visitor;
+		}
+		return 0;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_MHausdorff");
+		if (mode == 0) {
+			delete visitor;
+		}
+		return 0;		  
+	}
+	return 0;
+}
+
+SIDX_C_DLL double Index_SymmetricHausdorff(IndexH index, 
+		IndexH index2,
+		uint64_t* id1,
+		uint64_t* id2,
+		int* traversal_cost,
+		int* num_dist_cals,
+		int mode)
+{
+	VALIDATE_POINTER1(index, "Index_SymmetricHausdorff", RT_Failure);
+	VALIDATE_POINTER1(index2, "Index_SymmetricHausdorff", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+	Index* idx2 = static_cast<Index*>(index2);
+
+	IdVisitor* visitor = new IdVisitor;
+
+	try {	 
+
+		double h = idx->index().symmetricHausdorff(idx2->index(),
+				*id1,
+				*id2,
+				mode,
+				*visitor);
+
+		*num_dist_cals = visitor->getNumDistCals();
+		*traversal_cost = visitor->getTraversalCost();
+		delete visitor;
+		return h;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_SymmetricHausdorff");
+		delete visitor;
+		return 0;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_SymmetricHausdorff");
+		delete visitor;
+		return 0;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_SymmetricHausdorff");
+		delete visitor;
+		return 0;		  
+	}
+	return 0;
+}
+
+SIDX_C_DLL RTError Index_HausdorffTopK(IndexH index,
+		IndexH* collection,
+		uint32_t nCollection,
+		uint32_t k,
+		int mode,
+		int symmetric,
+		uint32_t** positions,
+		double** distances,
+		uint32_t* nResults,
+		int* num_dist_cals)
+{
+	VALIDATE_POINTER1(index, "Index_HausdorffTopK", RT_Failure);
+	VALIDATE_POINTER1(collection, "Index_HausdorffTopK", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+
+	IdVisitor* visitor = new IdVisitor;
+
+	try {
+		std::vector<SpatialIndex::ISpatialIndex*> items(nCollection);
+		for (uint32_t i=0; i < nCollection; ++i)
+		{
+			items[i] = &(static_cast<Index*>(collection[i])->index());
+		}
+
+		std::vector<std::pair<double, uint32_t> > results;
+		SpatialIndex::RTree::hausdorffTopK(idx->index(), items, k, mode, symmetric != 0, results, *visitor);
+
+		*nResults = results.size();
+		*positions = (uint32_t*) malloc (*nResults * sizeof(uint32_t));
+		*distances = (double*) malloc (*nResults * sizeof(double));
+
+		for (uint32_t i=0; i < *nResults; ++i)
+		{
+			(*distances)[i] = results[i].first;
+			(*positions)[i] = results[i].second;
+		}
+
+		*num_dist_cals = visitor->getNumDistCals();
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_HausdorffTopK");
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_HausdorffTopK");
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_HausdorffTopK");
+		delete visitor;
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_HausdorffRange(IndexH index,
+		IndexH* collection,
+		uint32_t nCollection,
+		double eps,
+		int mode,
+		int symmetric,
+		uint32_t** positions,
+		double** distances,
+		uint32_t* nResults,
+		int* num_dist_cals)
+{
+	VALIDATE_POINTER1(index, "Index_HausdorffRange", RT_Failure);
+	VALIDATE_POINTER1(collection, "Index_HausdorffRange", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+
+	IdVisitor* visitor = new IdVisitor;
+
+	try {
+		std::vector<SpatialIndex::ISpatialIndex*> items(nCollection);
+		for (uint32_t i=0; i < nCollection; ++i)
+		{
+			items[i] = &(static_cast<Index*>(collection[i])->index());
+		}
+
+		std::vector<std::pair<double, uint32_t> > results;
+		SpatialIndex::RTree::hausdorffRange(idx->index(), items, eps, mode, symmetric != 0, results, *visitor);
+
+		*nResults = results.size();
+		*positions = (uint32_t*) malloc (*nResults * sizeof(uint32_t));
+		*distances = (double*) malloc (*nResults * sizeof(double));
+
+		for (uint32_t i=0; i < *nResults; ++i)
+		{
+			(*distances)[i] = results[i].first;
+			(*positions)[i] = results[i].second;
+		}
+
+		*num_dist_cals = visitor->getNumDistCals();
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_HausdorffRange");
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_HausdorffRange");
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_HausdorffRange");
+		delete visitor;
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_HausdorffProgressive(IndexH index,
+		IndexH index2,
+		double eps,
+		double time_limit,
+		uint32_t max_dist_cals,
+		double* lb,
+		double* ub,
+		int64_t* id1,
+		int64_t* id2,
+		int* num_dist_cals)
+{
+	VALIDATE_POINTER1(index, "Index_HausdorffProgressive", RT_Failure);
+	VALIDATE_POINTER1(index2, "Index_HausdorffProgressive", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+	Index* idx2 = static_cast<Index*>(index2);
+
+	IdVisitor* visitor = new IdVisitor;
+
+	try {
+		SpatialIndex::RTree::HausdorffBounds b;
+		SpatialIndex::RTree::hausdorffProgressive(idx->index(), idx2->index(), eps, time_limit, max_dist_cals, b, *visitor);
+
+		*lb = b.m_lb;
+		*ub = b.m_ub;
+		*id1 = b.m_id1;
+		*id2 = b.m_id2;
+
+		*num_dist_cals = visitor->getNumDistCals();
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_HausdorffProgressive");
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_HausdorffProgressive");
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_HausdorffProgressive");
+		delete visitor;
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_HausdorffCascade(IndexH index,
+		IndexH index2,
+		double threshold,
+		int mode,
+		int mean,
+		double* distance,
+		int* deciding_mode,
+		int64_t* id1,
+		int64_t* id2,
+		int* num_dist_cals)
+{
+	VALIDATE_POINTER1(index, "Index_HausdorffCascade", RT_Failure);
+	VALIDATE_POINTER1(index2, "Index_HausdorffCascade", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+	Index* idx2 = static_cast<Index*>(index2);
+
+	IdVisitor* visitor = new IdVisitor;
+
+	try {
+		uint64_t i1 = static_cast<uint64_t>(-1), i2 = static_cast<uint64_t>(-1);
+		*distance = SpatialIndex::RTree::hausdorffCascade(idx->index(), idx2->index(), threshold, mode, mean != 0, i1, i2, *visitor);
+
+		*deciding_mode = visitor->getDecidingMode();
+		*id1 = static_cast<int64_t>(i1);
+		*id2 = static_cast<int64_t>(i2);
+
+		*num_dist_cals = visitor->getNumDistCals();
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_HausdorffCascade");
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_HausdorffCascade");
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_HausdorffCascade");
+		delete visitor;
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_HausdorffWithin(IndexH index,
+		IndexH index2,
+		double eps,
+		int* within,
+		int* num_dist_cals)
+{
+	VALIDATE_POINTER1(index, "Index_HausdorffWithin", RT_Failure);
+	VALIDATE_POINTER1(index2, "Index_HausdorffWithin", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+	Index* idx2 = static_cast<Index*>(index2);
+
+	IdVisitor* visitor = new IdVisitor;
+
+	try {
+		*within = SpatialIndex::RTree::hausdorffWithin(idx->index(), idx2->index(), eps, *visitor) ? 1 : 0;
+
+		*num_dist_cals = visitor->getNumDistCals();
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_HausdorffWithin");
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_HausdorffWithin");
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_HausdorffWithin");
+		delete visitor;
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_PartialHausdorff(IndexH index,
+		IndexH index2,
+		uint32_t k,
+		double* distance,
+		int64_t* id1,
+		int64_t* id2,
+		int* num_dist_cals)
+{
+	VALIDATE_POINTER1(index, "Index_PartialHausdorff", RT_Failure);
+	VALIDATE_POINTER1(index2, "Index_PartialHausdorff", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+	Index* idx2 = static_cast<Index*>(index2);
+
+	IdVisitor* visitor = new IdVisitor;
+
+	try {
+		uint64_t i1 = static_cast<uint64_t>(-1), i2 = static_cast<uint64_t>(-1);
+		*distance = SpatialIndex::RTree::partialHausdorff(idx->index(), idx2->index(), k, i1, i2, *visitor);
+
+		*id1 = static_cast<int64_t>(i1);
+		*id2 = static_cast<int64_t>(i2);
+
+		*num_dist_cals = visitor->getNumDistCals();
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_PartialHausdorff");
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_PartialHausdorff");
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_PartialHausdorff");
+		delete visitor;
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_QuantileHausdorff(IndexH index,
+		IndexH index2,
+		double quantile,
+		double* distance,
+		int64_t* id1,
+		int64_t* id2,
+		int* num_dist_cals)
+{
+	VALIDATE_POINTER1(index, "Index_QuantileHausdorff", RT_Failure);
+	VALIDATE_POINTER1(index2, "Index_QuantileHausdorff", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+	Index* idx2 = static_cast<Index*>(index2);
+
+	IdVisitor* visitor = new IdVisitor;
+
+	try {
+		uint64_t i1 = static_cast<uint64_t>(-1), i2 = static_cast<uint64_t>(-1);
+		*distance = SpatialIndex::RTree::quantileHausdorff(idx->index(), idx2->index(), quantile, i1, i2, *visitor);
+
+		*id1 = static_cast<int64_t>(i1);
+		*id2 = static_cast<int64_t>(i2);
+
+		*num_dist_cals = visitor->getNumDistCals();
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_QuantileHausdorff");
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_QuantileHausdorff");
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_QuantileHausdorff");
+		delete visitor;
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_ClosestPairs(IndexH index,
+		IndexH index2,
+		uint32_t k,
+		int64_t** ids1,
+		int64_t** ids2,
+		double** distances,
+		uint32_t* nResults)
+{
+	VALIDATE_POINTER1(index, "Index_ClosestPairs", RT_Failure);
+	VALIDATE_POINTER1(index2, "Index_ClosestPairs", RT_Failure);
+	Index* idx = static_cast<Index*>(index);
+	Index* idx2 = static_cast<Index*>(index2);
+
+	PairVisitor* pairs = new PairVisitor;
+	IdVisitor* visitor = new IdVisitor;
+
+	try {
+		SpatialIndex::RTree::closestPairsQuery(idx->index(), idx2->index(), k, *pairs, *visitor);
+
+		*nResults = pairs->GetResultCount();
+		*ids1 = (int64_t*) malloc (*nResults * sizeof(int64_t));
+		*ids2 = (int64_t*) malloc (*nResults * sizeof(int64_t));
+		*distances = (double*) malloc (*nResults * sizeof(double));
+
+		for (uint32_t i=0; i < *nResults; ++i)
+		{
+			(*ids1)[i] = pairs->GetIds1()[i];
+			(*ids2)[i] = pairs->GetIds2()[i];
+			(*distances)[i] = pairs->GetDistances()[i];
+		}
+
+		delete pairs;
+		delete visitor;
+
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"Index_ClosestPairs");
+		delete pairs;
+		delete visitor;
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"Index_ClosestPairs");
+		delete pairs;
+		delete visitor;
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"Index_ClosestPairs");
+		delete pairs;
+		delete visitor;
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL RTError Index_SpatialJoin(IndexH index,
+		IndexH index2,
+		double distance,
+		int64_t** ids1,
+		int64_t** ids2,
+		double** distances,
+		uint64_t* nResults)
+{
+	VALIDATE_POINTER1(index, "Index_SpatialJoin", RT_Failure);
+	VALIDATE_POINTER1(index2, "Index_SpatialJoin", RT_Failure);
 	Index* idx = static_cast<Index*>(index);
 	Index* idx2 = static_cast<Index*>(index2);
 
-	IdVisitor* visitor = 0;
-	//if (mode == 0) {
-		visitor = new IdVisitor;
-	//}
+	PairVisitor* pairs = new PairVisitor;
+	IdVisitor* visitor = new IdVisitor;
 
-	try {	 
+	try {
+		SpatialIndex::RTree::spatialJoinQuery(idx->index(), idx2->index(), distance, *pairs, *visitor);
 
-		double h = idx->index().hausdorff(idx2->index(),
-				*id1,
-				*id2,
-				mode,
-				*visitor);
+		*nResults = pairs->GetResultCount();
+		*ids1 = (int64_t*) malloc (*nResults * sizeof(int64_t));
+		*ids2 = (int64_t*) malloc (*nResults * sizeof(int64_t));
+		*distances = (double*) malloc (*nResults * sizeof(double));
 
-    *num_dist_cals = visitor->getNumDistCals();
+		for (uint64_t i=0; i < *nResults; ++i)
+		{
+			(*ids1)[i] = pairs->GetIds1()[i];
+			(*ids2)[i] = pairs->GetIds2()[i];
+			(*distances)[i] = pairs->GetDistances()[i];
+		}
 
-		//if (mode == 0) {
-			*traversal_cost = visitor->getTraversalCost();
-			delete visitor;
-		//}
-		return h;
+		delete pairs;
+		delete visitor;
 
 	} catch (Tools::Exception& e)
 	{
 		Error_PushError(RT_Failure, 
 				e.what().c_str(),
-				"Index_Hausdorff");
-		if (mode == 0) {
-			delete visitor;
-		}
-		return 0;
+				"Index_SpatialJoin");
+		delete pairs;
+		delete visitor;
+		return RT_Failure;
 	} catch (std::exception const& e)
 	{
 		Error_PushError(RT_Failure, 
 				e.what(),
-				"Index_Hausdorff");
-		if (mode == 0) {
-			delete visitor;
-		}
-		return 0;
+				"Index_SpatialJoin");
+		delete pairs;
+		delete visitor;
+		return RT_Failure;
 	} catch (...) {
 		Error_PushError(RT_Failure, 
 				"Unknown Error",
-				"Index_Hausdorff");
-		if (mode == 0) {
-			delete visitor;
-		}
-		return 0;		  
+				"Index_SpatialJoin");
+		delete pairs;
+		delete visitor;
+		return RT_Failure;		  
 	}
-	return 0;
+	return RT_None;
 }
 
-SIDX_C_DLL double Index_MHausdorff(IndexH index, 
-		IndexH index2,
-		uint64_t* id1,
-		uint64_t* id2,
-		int* traversal_cost,
-    int* num_dist_cals,
-		int mode)
+SIDX_C_DLL RTError Index_HausdorffMatrix(IndexH* collection,
+		uint32_t nCollection,
+		int mode,
+		int mean,
+		int symmetric,
+		double threshold,
+		uint32_t threads,
+		uint32_t** rows,
+		uint32_t** columns,
+		double** distances,
+		uint64_t* nResults,
+		int* num_dist_cals)
 {
-	VALIDATE_POINTER1(index, "Index_MHausdorff", RT_Failure);
-	VALIDATE_POINTER1(index2, "Index_MHausdorff", RT_Failure);
-	Index* idx = static_cast<Index*>(index);
-	Index* idx2 = static_cast<Index*>(index2);
+	VALIDATE_POINTER1(collection, "Index_HausdorffMatrix", RT_Failure);
 
-	IdVisitor* visitor = 0;
-	//if (mode == 0) {
-		visitor = new IdVisitor;
-	//}
+	IdVisitor* visitor = new IdVisitor;
 
-	try {	 
+	try {
+		std::vector<SpatialIndex::ISpatialIndex*> items(nCollection);
+		for (uint32_t i=0; i < nCollection; ++i)
+		{
+			items[i] = &(static_cast<Index*>(collection[i])->index());
+		}
 
-		double h = idx->index().mhausdorff(idx2->index(),
-				*id1,
-				*id2,
-				mode,
-				*visitor);
+		std::vector<SpatialIndex::RTree::HausdorffMatrixEntry> results;
+		SpatialIndex::RTree::hausdorffMatrix(items, mode, mean != 0, symmetric != 0, threshold, threads, results, *visitor);
 
-    *num_dist_cals = visitor->getNumDistCals();
+		*nResults = results.size();
+		*rows = (uint32_t*) malloc (*nResults * sizeof(uint32_t));
+		*columns = (uint32_t*) malloc (*nResults * sizeof(uint32_t));
+		*distances = (double*) malloc (*nResults * sizeof(double));
 
-		//if (mode == 0) {
-			*traversal_cost = visitor->getTraversalCost();
-			delete visitor;
-		//}
-		return h;
+		for (uint64_t i=0; i < *nResults; ++i)
+		{
+			(*rows)[i] = results[i].m_row;
+			(*columns)[i] = results[i].m_column;
+			(*distances)[i] = results[i].m_dist;
+		}
+
+		*num_dist_cals = visitor->getNumDistCals();
+		delete visitor;
 
 	} catch (Tools::Exception& e)
 	{
 		Error_PushError(RT_Failure, 
 				e.what().c_str(),
-				"Index_MHausdorff");
-		if (mode == 0) {
-			delete visitor;
-		}
-		return 0;
+				"Index_HausdorffMatrix");
+		delete visitor;
+		return RT_Failure;
 	} catch (std::exception const& e)
 	{
 		Error_PushError(RT_Failure, 
 				e.what(),
-				"Index_MHausdorff");
-		if (mode == 0) {
-			delete visitor;
-		}
-		return 0;
+				"Index_HausdorffMatrix");
+		delete visitor;
+		return RT_Failure;
 	} catch (...) {
 		Error_PushError(RT_Failure, 
 				"Unknown Error",
-				"Index_MHausdorff");
-		if (mode == 0) {
-			delete visitor;
-		}
-		return 0;		  
+				"Index_HausdorffMatrix");
+		delete visitor;
+		return RT_Failure;		  
 	}
-	return 0;
+	return RT_None;
 }
 
 SIDX_DLL void Index_SelectMBRs(IndexH index,
@@ -1702,6 +2326,66 @@ SIDX_C_DLL uint32_t IndexProperty_GetPointPoolCapacity(IndexPropertyH hProp)
 	return 0;
 }
 
+SIDX_C_DLL RTError IndexProperty_SetWorkerThreads(IndexPropertyH hProp, 
+		uint32_t value)
+{
+	VALIDATE_POINTER1(hProp, "IndexProperty_SetWorkerThreads", RT_Failure);	   
+	Tools::PropertySet* prop = static_cast<Tools::PropertySet*>(hProp);
+
+	try
+	{
+		Tools::Variant var;
+		var.m_varType = Tools::VT_ULONG;
+		var.m_val.ulVal = value;
+		prop->setProperty("WorkerThreads", var);
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"IndexProperty_SetWorkerThreads");
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"IndexProperty_SetWorkerThreads");
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"IndexProperty_SetWorkerThreads");
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL uint32_t IndexProperty_GetWorkerThreads(IndexPropertyH hProp)
+{
+	VALIDATE_POINTER1(hProp, "IndexProperty_GetWorkerThreads", 0);
+	Tools::PropertySet* prop = static_cast<Tools::PropertySet*>(hProp);
+
+	Tools::Variant var;
+	var = prop->getProperty("WorkerThreads");
+
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_ULONG) {
+			Error_PushError(RT_Failure, 
+					"Property WorkerThreads must be Tools::VT_ULONG",
+					"IndexProperty_GetWorkerThreads");
+			return 0;
+		}
+
+		return var.m_val.ulVal;
+	}
+
+	// return nothing for an error
+	Error_PushError(RT_Failure, 
+			"Property WorkerThreads was empty",
+			"IndexProperty_GetWorkerThreads");
+	return 0;
+}
+
 SIDX_C_DLL RTError IndexProperty_SetNearMinimumOverlapFactor( IndexPropertyH hProp, 
 		uint32_t value)
 {
@@ -1891,6 +2575,138 @@ SIDX_C_DLL uint32_t IndexProperty_GetEnsureTightMBRs(IndexPropertyH hProp)
 	return 0;
 }
 
+SIDX_C_DLL RTError IndexProperty_SetAggregateCounts(  IndexPropertyH hProp, 
+		uint32_t value)
+{
+	VALIDATE_POINTER1(hProp, "IndexProperty_SetAggregateCounts", RT_Failure);	 
+	Tools::PropertySet* prop = static_cast<Tools::PropertySet*>(hProp);
+
+	try
+	{
+		if (value > 1 ) {
+			Error_PushError(RT_Failure, 
+					"AggregateCounts is a boolean value and must be 1 or 0",
+					"IndexProperty_SetAggregateCounts");
+			return RT_Failure;
+		}
+		Tools::Variant var;
+		var.m_varType = Tools::VT_BOOL;
+		var.m_val.blVal = (bool)value;
+		prop->setProperty("AggregateCounts", var);
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"IndexProperty_SetAggregateCounts");
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"IndexProperty_SetAggregateCounts");
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"IndexProperty_SetAggregateCounts");
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL uint32_t IndexProperty_GetAggregateCounts(IndexPropertyH hProp)
+{
+	VALIDATE_POINTER1(hProp, "IndexProperty_GetAggregateCounts", 0);
+	Tools::PropertySet* prop = static_cast<Tools::PropertySet*>(hProp);
+
+	Tools::Variant var;
+	var = prop->getProperty("AggregateCounts");
+
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_BOOL) {
+			Error_PushError(RT_Failure, 
+					"Property AggregateCounts must be Tools::VT_BOOL",
+					"IndexProperty_GetAggregateCounts");
+			return 0;
+		}
+
+		return var.m_val.blVal;
+	}
+
+	// return nothing for an error
+	Error_PushError(RT_Failure, 
+			"Property AggregateCounts was empty",
+			"IndexProperty_GetAggregateCounts");
+	return 0;
+}
+
+SIDX_C_DLL RTError IndexProperty_SetCoverSelection(  IndexPropertyH hProp, 
+		uint32_t value)
+{
+	VALIDATE_POINTER1(hProp, "IndexProperty_SetCoverSelection", RT_Failure);	 
+	Tools::PropertySet* prop = static_cast<Tools::PropertySet*>(hProp);
+
+	try
+	{
+		if (value != SpatialIndex::RTree::CS_AREA && value != SpatialIndex::RTree::CS_DEADSPACE) {
+			Error_PushError(RT_Failure, 
+					"CoverSelection must be 0 (area) or 1 (dead space)",
+					"IndexProperty_SetCoverSelection");
+			return RT_Failure;
+		}
+		Tools::Variant var;
+		var.m_varType = Tools::VT_LONG;
+		var.m_val.lVal = value;
+		prop->setProperty("CoverSelection", var);
+	} catch (Tools::Exception& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what().c_str(),
+				"IndexProperty_SetCoverSelection");
+		return RT_Failure;
+	} catch (std::exception const& e)
+	{
+		Error_PushError(RT_Failure, 
+				e.what(),
+				"IndexProperty_SetCoverSelection");
+		return RT_Failure;
+	} catch (...) {
+		Error_PushError(RT_Failure, 
+				"Unknown Error",
+				"IndexProperty_SetCoverSelection");
+		return RT_Failure;		  
+	}
+	return RT_None;
+}
+
+SIDX_C_DLL uint32_t IndexProperty_GetCoverSelection(IndexPropertyH hProp)
+{
+	VALIDATE_POINTER1(hProp, "IndexProperty_GetCoverSelection", 0);
+	Tools::PropertySet* prop = static_cast<Tools::PropertySet*>(hProp);
+
+	Tools::Variant var;
+	var = prop->getProperty("CoverSelection");
+
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_LONG) {
+			Error_PushError(RT_Failure, 
+					"Property CoverSelection must be Tools::VT_LONG",
+					"IndexProperty_GetCoverSelection");
+			return 0;
+		}
+
+		return var.m_val.lVal;
+	}
+
+	// return nothing for an error
+	Error_PushError(RT_Failure, 
+			"Property CoverSelection was empty",
+			"IndexProperty_GetCoverSelection");
+	return 0;
+}
+
 SIDX_C_DLL RTError IndexProperty_SetWriteThrough(IndexPropertyH hProp, 
 		uint32_t value)
 {
@@ -386,6 +386,11 @@ double SpatialIndex::MVRTree::MVRTree::mhausdorff(ISpatialIndex& query, uint64_t
 
 }
 
+double SpatialIndex::MVRTree::MVRTree::symmetricHausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v)
+{
+	throw Tools::IllegalStateException("symmetricHausdorff: not impelmented yet.");
+}
+
 
 void SpatialIndex::MVRTree::MVRTree::clearMBRs()
 {
@@ -402,7 +402,10 @@ void BulkLoader::createLevel(
 				Node* n = createNode(pTree, node, level);
 				node.clear();
 				pTree->writeNode(n);
-				es2->insert(new ExternalSorter::Record(n->m_nodeMBR, n->m_identifier, 0, 0, 0));
+				uint32_t len;
+				byte* data;
+				n->getCountData(len, &data);
+				es2->insert(new ExternalSorter::Record(n->m_nodeMBR, n->m_identifier, len, data, 0));
 				pTree->m_rootID = n->m_identifier;
 					// special case when the root has exactly bindex entries.
 				delete n;
@@ -413,7 +416,10 @@ void BulkLoader::createLevel(
 		{
 			Node* n = createNode(pTree, node, level);
 			pTree->writeNode(n);
-			es2->insert(new ExternalSorter::Record(n->m_nodeMBR, n->m_identifier, 0, 0, 0));
+			uint32_t len;
+			byte* data;
+			n->getCountData(len, &data);
+			es2->insert(new ExternalSorter::Record(n->m_nodeMBR, n->m_identifier, len, data, 0));
 			pTree->m_rootID = n->m_identifier;
 			delete n;
 		}
@@ -0,0 +1,278 @@
+// Spatial Index Library
+//
+// Copyright (C) 2002 Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+#include <cmath>
+#include <limits>
+
+#include "../spatialindex/SpatialIndexImpl.h"
+#include "RTree.h"
+
+using namespace SpatialIndex;
+
+/*
+ *  All-pairs Hausdorff distance matrix of a collection of trees.
+ *
+ *  Node reads go through the tree's pools and storage manager, which are not
+ *  safe to share between threads, so only the engines that work on m_pointBuffer
+ *  are allowed here. The point lists are built up front on the calling thread;
+ *  the workers only read them.
+ *
+ *  Work item i is row i of the upper triangle. Both directions of a pair are
+ *  computed by the same worker, one after the other, while the points are hot
+ *  in the cache. The pairs of a row are refined in increasing order of their
+ *  lower bound, and pairs whose bound is above the threshold are never refined.
+ */
+
+class DistanceCountVisitor : public IVisitor
+{
+public:
+	DistanceCountVisitor() : m_numDistCals(0), m_distance(0.0) {}
+
+	void visitNode(const INode& n) {}
+	void visitData(const IData& d) {}
+	void visitData(std::vector<const IData*>& v) {}
+
+	void incNumDistCals(int num) { m_numDistCals += num; }
+	int getNumDistCals() { return m_numDistCals; }
+	double getDistance() { return m_distance; }
+	void setDistance(double dist) { m_distance = dist; }
+
+	int m_numDistCals;
+	double m_distance;
+}; // DistanceCountVisitor
+
+class HausdorffMatrixCandidate
+{
+public:
+	uint32_t m_column;
+	double m_lb;
+		// for both directions together if the matrix is symmetric.
+	double m_lbReverse;
+
+	HausdorffMatrixCandidate(uint32_t column, double lb, double lbReverse) : m_column(column), m_lb(lb), m_lbReverse(lbReverse) {}
+
+	bool operator<(const HausdorffMatrixCandidate& c) const { return std::min(m_lb, m_lbReverse) < std::min(c.m_lb, c.m_lbReverse); }
+}; // HausdorffMatrixCandidate
+
+static bool compareMatrixEntries(const SpatialIndex::RTree::HausdorffMatrixEntry& a, const SpatialIndex::RTree::HausdorffMatrixEntry& b)
+{
+	if (a.m_row != b.m_row) return a.m_row < b.m_row;
+	return a.m_column < b.m_column;
+}
+
+namespace SpatialIndex
+{
+	namespace RTree
+	{
+		class HausdorffMatrixTask : public Tools::IParallelTask
+		{
+		public:
+			HausdorffMatrixTask(const std::vector<ISpatialIndex*>& collection, int mode, bool bMean, bool bSymmetric, double threshold, uint32_t threads);
+
+			virtual void run(uint32_t index, uint32_t thread);
+
+			double getLowerBound(uint32_t a, uint32_t b, IVisitor& v);
+			double getDistance(uint32_t a, uint32_t b, double bound, std::vector<double>* pQueryUB, const std::vector<double>* pUB, IVisitor& v);
+
+			std::vector<RTree*> m_trees;
+			std::vector<double> m_low;
+			std::vector<double> m_high;
+				// bounding box of the points of every tree, m_dimension values per tree.
+			uint32_t m_dimension;
+			int m_mode;
+			bool m_bMean;
+			bool m_bSymmetric;
+			double m_threshold;
+
+			std::vector<std::vector<HausdorffMatrixEntry> > m_results;
+			std::vector<DistanceCountVisitor> m_visitors;
+				// one per worker.
+		}; // HausdorffMatrixTask
+	}
+}
+
+SpatialIndex::RTree::HausdorffMatrixTask::HausdorffMatrixTask(const std::vector<ISpatialIndex*>& collection, int mode, bool bMean, bool bSymmetric, double threshold, uint32_t threads) :
+	m_dimension(0),
+	m_mode(mode),
+	m_bMean(bMean),
+	m_bSymmetric(bSymmetric),
+	m_threshold(threshold),
+	m_results(threads),
+	m_visitors(threads)
+{
+	if (bMean && mode != 0)
+		throw Tools::IllegalArgumentException("hausdorffMatrix: mhausdorff supports mode 0 only.");
+	if (! bMean && mode != 0 && mode != -3 && mode != -4)
+		throw Tools::IllegalArgumentException("hausdorffMatrix: hausdorff supports modes 0, -3 and -4 only.");
+
+	for (uint32_t cIndex = 0; cIndex < collection.size(); ++cIndex)
+	{
+		RTree* t = dynamic_cast<RTree*>(collection[cIndex]);
+		if (t == 0) throw Tools::IllegalArgumentException("hausdorffMatrix: collection holds an index that is not an RTree.");
+
+		t->listAllPoints();
+		m_trees.push_back(t);
+
+		if (cIndex == 0) m_dimension = t->m_dimension;
+		else if (t->m_dimension != m_dimension) throw Tools::IllegalArgumentException("hausdorffMatrix: trees have different number of dimensions.");
+	}
+
+	m_low.assign(m_trees.size() * m_dimension, std::numeric_limits<double>::max());
+	m_high.assign(m_trees.size() * m_dimension, -std::numeric_limits<double>::max());
+
+	for (uint32_t cIndex = 0; cIndex < m_trees.size(); ++cIndex)
+	{
+		const PointBuffer& pts = m_trees[cIndex]->m_pointBuffer;
+
+		for (uint32_t i = 0; i < pts.size(); ++i)
+		{
+			for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+			{
+				m_low[cIndex * m_dimension + cDim] = std::min(m_low[cIndex * m_dimension + cDim], pts.getCoordinate(i, cDim));
+				m_high[cIndex * m_dimension + cDim] = std::max(m_high[cIndex * m_dimension + cDim], pts.getCoordinate(i, cDim));
+			}
+		}
+	}
+}
+
+// A lower bound of the directed distance from tree a to tree b.
+double SpatialIndex::RTree::HausdorffMatrixTask::getLowerBound(uint32_t a, uint32_t b, IVisitor& v)
+{
+	// every nearest neighbor distance is at least the distance between the bounding boxes.
+	double lb = 0.0;
+
+	for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+	{
+		double x = 0.0;
+		if (m_high[b * m_dimension + cDim] < m_low[a * m_dimension + cDim]) x = m_low[a * m_dimension + cDim] - m_high[b * m_dimension + cDim];
+		else if (m_high[a * m_dimension + cDim] < m_low[b * m_dimension + cDim]) x = m_low[b * m_dimension + cDim] - m_high[a * m_dimension + cDim];
+		lb += x * x;
+	}
+	lb = std::sqrt(lb);
+
+	// the selected MBRs only exist in memory, so modes 1 and 2 are safe here.
+	if (! m_bMean && m_trees[a]->m_pRootMBR != 0 && m_trees[b]->m_pRootMBR != 0)
+	{
+		uint64_t id1, id2;
+		lb = std::max(lb, m_trees[a]->hausdorff(*(m_trees[b]), id1, id2, 2, v));
+	}
+
+	return lb;
+}
+
+double SpatialIndex::RTree::HausdorffMatrixTask::getDistance(uint32_t a, uint32_t b, double bound, std::vector<double>* pQueryUB, const std::vector<double>* pUB, IVisitor& v)
+{
+	uint64_t id1, id2;
+
+	if (m_bMean) return m_trees[a]->getMeanNearestDistance(*(m_trees[b]), 1, v);
+	if (m_mode == 0) return std::max(bound, m_trees[a]->hausdorff2(*(m_trees[b]), id1, id2, 1, v));
+	return m_trees[a]->hausdorffEarlyBreak(*(m_trees[b]), id1, id2, m_mode == -4, bound, m_threshold, pUB, pQueryUB, v);
+}
+
+void SpatialIndex::RTree::HausdorffMatrixTask::run(uint32_t index, uint32_t thread)
+{
+	DistanceCountVisitor& v = m_visitors[thread];
+	std::vector<HausdorffMatrixEntry>& results = m_results[thread];
+
+	// pairs with an empty tree have no meaningful distance and are left out.
+	if (m_trees[index]->m_pointBuffer.empty()) return;
+
+	std::vector<HausdorffMatrixCandidate> candidates;
+
+	for (uint32_t cIndex = index + 1; cIndex < m_trees.size(); ++cIndex)
+	{
+		if (m_trees[cIndex]->m_pointBuffer.empty()) continue;
+
+		double lb = getLowerBound(index, cIndex, v);
+		double lbReverse = getLowerBound(cIndex, index, v);
+
+		if (m_bSymmetric)
+		{
+			lb = lbReverse = std::max(lb, lbReverse);
+		}
+
+		if (lb <= m_threshold || lbReverse <= m_threshold)
+		{
+			candidates.push_back(HausdorffMatrixCandidate(cIndex, lb, lbReverse));
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+
+	std::vector<double> ub;
+
+	for (uint32_t cIndex = 0; cIndex < candidates.size(); ++cIndex)
+	{
+		uint32_t column = candidates[cIndex].m_column;
+
+		if (m_bSymmetric)
+		{
+			// the second direction only looks for distances above the first one.
+			double h = getDistance(index, column, 0.0, &ub, 0, v);
+			if (h > m_threshold) continue;
+
+			if (m_bMean) h = std::max(h, getDistance(column, index, 0.0, 0, 0, v));
+			else h = getDistance(column, index, h, 0, &ub, v);
+
+			if (h <= m_threshold) results.push_back(HausdorffMatrixEntry(index, column, h));
+		}
+		else
+		{
+			if (candidates[cIndex].m_lb <= m_threshold)
+			{
+				double h = getDistance(index, column, 0.0, 0, 0, v);
+				if (h <= m_threshold) results.push_back(HausdorffMatrixEntry(index, column, h));
+			}
+
+			if (candidates[cIndex].m_lbReverse <= m_threshold)
+			{
+				double h = getDistance(column, index, 0.0, 0, 0, v);
+				if (h <= m_threshold) results.push_back(HausdorffMatrixEntry(column, index, h));
+			}
+		}
+	}
+}
+
+void SpatialIndex::RTree::hausdorffMatrix(
+	const std::vector<ISpatialIndex*>& collection,
+	int mode,
+	bool bMean,
+	bool bSymmetric,
+	double threshold,
+	uint32_t threads,
+	std::vector<HausdorffMatrixEntry>& results,
+	IVisitor& v)
+{
+	results.clear();
+
+	if (threads == 0) threads = Tools::getNumberOfProcessors();
+
+	HausdorffMatrixTask task(collection, mode, bMean, bSymmetric, threshold, threads);
+	Tools::runParallel(task, collection.size(), threads);
+
+	for (uint32_t cThread = 0; cThread < threads; ++cThread)
+	{
+		results.insert(results.end(), task.m_results[cThread].begin(), task.m_results[cThread].end());
+		v.incNumDistCals(task.m_visitors[cThread].m_numDistCals);
+	}
+
+	std::sort(results.begin(), results.end(), compareMatrixEntries);
+}
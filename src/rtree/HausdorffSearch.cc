@@ -0,0 +1,180 @@
+// Spatial Index Library
+//
+// Copyright (C) 2002 Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+#include <cmath>
+#include <limits>
+
+#include "../spatialindex/SpatialIndexImpl.h"
+#include "RTree.h"
+
+using namespace SpatialIndex;
+
+/*
+ *  Filter and refine search of a collection of trees by Hausdorff distance.
+ *
+ *  Every member of the collection goes through a fixed sequence of stages:
+ *  the mindist of the roots (mode 3), the root MBR bound (mode 1), the
+ *  selectMBRs bound (mode 2) and finally the exact distance. Members are kept
+ *  in a min-heap on the best value known so far and only the top one is taken
+ *  to its next stage. Since every stage bounds the exact distance from below,
+ *  a member that reaches the top with its exact distance is the next result
+ *  and the rest of the heap never needs refining [Seidl, Kriegel 'Optimal
+ *  Multi-Step k-Nearest Neighbor Search', SIGMOD 1998].
+ */
+
+static const int HausdorffStages[] = {3, 1, 2};
+static const uint32_t HausdorffExactStage = sizeof(HausdorffStages) / sizeof(HausdorffStages[0]);
+
+class HausdorffSearchEntry
+{
+public:
+	double m_dist;
+	uint32_t m_index;
+	uint32_t m_stage;
+
+	HausdorffSearchEntry(double dist, uint32_t index, uint32_t stage) : m_dist(dist), m_index(index), m_stage(stage) {}
+
+	struct ascending : public std::binary_function<HausdorffSearchEntry, HausdorffSearchEntry, bool>
+	{
+		bool operator()(const HausdorffSearchEntry& __x, const HausdorffSearchEntry& __y) const
+		{
+			if (__x.m_dist != __y.m_dist) return __x.m_dist > __y.m_dist;
+			// exact entries first, so that ties do not cause needless refinement.
+			return __x.m_stage < __y.m_stage;
+		}
+	};
+}; // HausdorffSearchEntry
+
+static double getStageDistance(ISpatialIndex& query, ISpatialIndex& item, uint32_t stage, int mode, bool bSymmetric, IVisitor& v)
+{
+	uint64_t id1, id2;
+
+	if (stage == HausdorffExactStage)
+	{
+		if (bSymmetric) return query.symmetricHausdorff(item, id1, id2, mode, v);
+		return query.hausdorff(item, id1, id2, mode, v);
+	}
+
+	double d = query.hausdorff(item, id1, id2, HausdorffStages[stage], v);
+	if (bSymmetric) d = std::max(d, item.hausdorff(query, id1, id2, HausdorffStages[stage], v));
+	return d;
+}
+
+static void search(
+	ISpatialIndex& query,
+	const std::vector<ISpatialIndex*>& collection,
+	uint32_t k,
+	double eps,
+	int mode,
+	bool bSymmetric,
+	std::vector<std::pair<double, uint32_t> >& results,
+	IVisitor& v)
+{
+	results.clear();
+	if (k == 0) return;
+
+	std::priority_queue<HausdorffSearchEntry, std::vector<HausdorffSearchEntry>, HausdorffSearchEntry::ascending> queue;
+
+	for (uint32_t cIndex = 0; cIndex < collection.size(); ++cIndex)
+	{
+		double d = getStageDistance(query, *(collection[cIndex]), 0, mode, bSymmetric, v);
+		if (d <= eps) queue.push(HausdorffSearchEntry(d, cIndex, 0));
+	}
+
+	while (! queue.empty())
+	{
+		HausdorffSearchEntry e = queue.top(); queue.pop();
+
+		if (e.m_stage == HausdorffExactStage)
+		{
+			results.push_back(std::make_pair(e.m_dist, e.m_index));
+			if (results.size() == k) break;
+			continue;
+		}
+
+		double d = getStageDistance(query, *(collection[e.m_index]), e.m_stage + 1, mode, bSymmetric, v);
+
+		// later stages are not necessarily tighter than earlier ones.
+		if (e.m_stage + 1 < HausdorffExactStage) d = std::max(d, e.m_dist);
+
+		if (d <= eps) queue.push(HausdorffSearchEntry(d, e.m_index, e.m_stage + 1));
+	}
+}
+
+void SpatialIndex::RTree::hausdorffTopK(
+	ISpatialIndex& query,
+	const std::vector<ISpatialIndex*>& collection,
+	uint32_t k,
+	int mode,
+	bool bSymmetric,
+	std::vector<std::pair<double, uint32_t> >& results,
+	IVisitor& v)
+{
+	search(query, collection, k, std::numeric_limits<double>::max(), mode, bSymmetric, results, v);
+}
+
+void SpatialIndex::RTree::hausdorffRange(
+	ISpatialIndex& query,
+	const std::vector<ISpatialIndex*>& collection,
+	double eps,
+	int mode,
+	bool bSymmetric,
+	std::vector<std::pair<double, uint32_t> >& results,
+	IVisitor& v)
+{
+	search(query, collection, std::numeric_limits<uint32_t>::max(), eps, mode, bSymmetric, results, v);
+}
+
+/*
+ *  Tightness of the selectMBRs bound. The ordered pairs are numbered row by
+ *  row, leaving out the diagonal, and every step-th one is sampled.
+ */
+
+double SpatialIndex::RTree::coverTightness(
+	const std::vector<ISpatialIndex*>& collection,
+	uint32_t samples,
+	int mode,
+	IVisitor& v)
+{
+	uint64_t n = collection.size();
+	if (n < 2 || samples == 0) return 1.0;
+
+	uint64_t pairs = n * (n - 1);
+	uint64_t step = std::max(static_cast<uint64_t>(1), pairs / samples);
+	double sum = 0.0;
+	uint32_t count = 0;
+
+	for (uint64_t cPair = 0; cPair < pairs && count < samples; cPair += step)
+	{
+		uint32_t row = static_cast<uint32_t>(cPair / (n - 1));
+		uint32_t column = static_cast<uint32_t>(cPair % (n - 1));
+		if (column >= row) ++column;
+
+		uint64_t id1, id2;
+		double exact = collection[row]->hausdorff(*(collection[column]), id1, id2, mode, v);
+		if (exact <= 0.0) continue;
+
+		sum += collection[row]->hausdorff(*(collection[column]), id1, id2, 2, v) / exact;
+		++count;
+	}
+
+	return (count == 0) ? 1.0 : sum / count;
+}
@@ -120,6 +120,9 @@ void Index::split(uint32_t dataLength, byte* pData, Region& mbr, id_type id, Nod
 	if (ptrLeft.get() == 0) ptrLeft = NodePtr(new Index(m_pTree, m_identifier, m_level), &(m_pTree->m_indexPool));
 	if (ptrRight.get() == 0) ptrRight = NodePtr(new Index(m_pTree, -1, m_level), &(m_pTree->m_indexPool));
 
+	// pooled nodes come back as leaves, and the level decides how entries are counted.
+	ptrLeft->m_level = m_level;
+	ptrRight->m_level = m_level;
 	ptrLeft->m_nodeMBR = m_pTree->m_infiniteRegion;
 	ptrRight->m_nodeMBR = m_pTree->m_infiniteRegion;
 
@@ -127,12 +130,15 @@ void Index::split(uint32_t dataLength, byte* pData, Region& mbr, id_type id, Nod
 
 	for (cIndex = 0; cIndex < g1.size(); ++cIndex)
 	{
-		ptrLeft->insertEntry(0, 0, *(m_ptrMBR[g1[cIndex]]), m_pIdentifier[g1[cIndex]]);
+		ptrLeft->insertEntry(m_pDataLength[g1[cIndex]], m_pData[g1[cIndex]], *(m_ptrMBR[g1[cIndex]]), m_pIdentifier[g1[cIndex]]);
+		// the subtree counts move with the entries.
+		m_pData[g1[cIndex]] = 0;
 	}
 
 	for (cIndex = 0; cIndex < g2.size(); ++cIndex)
 	{
-		ptrRight->insertEntry(0, 0, *(m_ptrMBR[g2[cIndex]]), m_pIdentifier[g2[cIndex]]);
+		ptrRight->insertEntry(m_pDataLength[g2[cIndex]], m_pData[g2[cIndex]], *(m_ptrMBR[g2[cIndex]]), m_pIdentifier[g2[cIndex]]);
+		m_pData[g2[cIndex]] = 0;
 	}
 }
 
@@ -292,6 +298,7 @@ void Index::adjustTree(Node* n, std::stack<id_type>& pathBuffer)
 	bool bRecompute = (! bContained || (bTouches && m_pTree->m_bTightMBRs));
 
 	*(m_ptrMBR[child]) = n->m_nodeMBR;
+	if (m_pTree->m_bAggregateCounts) setEntryCount(child, n->m_pointCount);
 
 	if (bRecompute)
 	{
@@ -310,7 +317,7 @@ void Index::adjustTree(Node* n, std::stack<id_type>& pathBuffer)
 
 	m_pTree->writeNode(this);
 
-	if (bRecompute && (! pathBuffer.empty()))
+	if ((bRecompute || m_pTree->m_bAggregateCounts) && (! pathBuffer.empty()))
 	{
 		id_type cParent = pathBuffer.top(); pathBuffer.pop();
 		NodePtr ptrN = m_pTree->readNode(cParent);
@@ -338,6 +345,7 @@ void Index::adjustTree(Node* n1, Node* n2, std::stack<id_type>& pathBuffer, byte
 	bool bRecompute = (! bContained || (bTouches && m_pTree->m_bTightMBRs));
 
 	*(m_ptrMBR[child]) = n1->m_nodeMBR;
+	if (m_pTree->m_bAggregateCounts) setEntryCount(child, n1->m_pointCount);
 
 	if (bRecompute)
 	{
@@ -357,12 +365,15 @@ void Index::adjustTree(Node* n1, Node* n2, std::stack<id_type>& pathBuffer, byte
 	// No write necessary here. insertData will write the node if needed.
 	//m_pTree->writeNode(this);
 
-	bool bAdjusted = insertData(0, 0, n2->m_nodeMBR, n2->m_identifier, pathBuffer, overflowTable);
+	uint32_t len;
+	byte* data;
+	n2->getCountData(len, &data);
+	bool bAdjusted = insertData(len, data, n2->m_nodeMBR, n2->m_identifier, pathBuffer, overflowTable);
 
 	// if n2 is contained in the node and there was no split or reinsert,
 	// we need to adjust only if recalculation took place.
 	// In all other cases insertData above took care of adjustment.
-	if ((! bAdjusted) && bRecompute && (! pathBuffer.empty()))
+	if ((! bAdjusted) && (bRecompute || m_pTree->m_bAggregateCounts) && (! pathBuffer.empty()))
 	{
 		id_type cParent = pathBuffer.top(); pathBuffer.pop();
 		NodePtr ptrN = m_pTree->readNode(cParent);
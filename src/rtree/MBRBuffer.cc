@@ -0,0 +1,162 @@
+// Spatial Index Library
+//
+// Copyright (C) 2002 Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include "../spatialindex/SpatialIndexImpl.h"
+#include "MBRBuffer.h"
+
+using namespace SpatialIndex::RTree;
+
+const uint32_t MBRBuffer::BlockSize;
+
+MBRBuffer::MBRBuffer() : m_dimension(0), m_size(0)
+{
+}
+
+void MBRBuffer::assign(const std::vector<const Region*>& mbrs, uint32_t dimension)
+{
+	m_dimension = dimension;
+	m_size = static_cast<uint32_t>(mbrs.size());
+	m_low.assign(dimension, std::vector<double>(m_size));
+	m_high.assign(dimension, std::vector<double>(m_size));
+
+	for (uint32_t i = 0; i < m_size; ++i)
+	{
+		for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			m_low[cDim][i] = mbrs[i]->m_pLow[cDim];
+			m_high[cDim][i] = mbrs[i]->m_pHigh[cDim];
+		}
+	}
+}
+
+void MBRBuffer::clear()
+{
+	m_size = 0;
+	m_low.clear();
+	m_high.clear();
+}
+
+void MBRBuffer::getMinimumDistancesSq(const double* pLow, const double* pHigh, uint32_t start, uint32_t count, double* out) const
+{
+	uint32_t i = 0;
+
+	// along each dimension the gap is max(0, low - pHigh) + max(0, pLow - high), at
+	// most one of which is positive.
+
+#if defined(__AVX512F__)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m512d zero = _mm512_setzero_pd();
+		__m512d acc = zero;
+		for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			__m512d a = _mm512_max_pd(_mm512_sub_pd(_mm512_loadu_pd(&(m_low[cDim][start + i])), _mm512_set1_pd(pHigh[cDim])), zero);
+			__m512d b = _mm512_max_pd(_mm512_sub_pd(_mm512_set1_pd(pLow[cDim]), _mm512_loadu_pd(&(m_high[cDim][start + i]))), zero);
+			__m512d d = _mm512_add_pd(a, b);
+			acc = _mm512_add_pd(acc, _mm512_mul_pd(d, d));
+		}
+		_mm512_storeu_pd(out + i, acc);
+	}
+#endif
+
+#if defined(__AVX__)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m256d zero = _mm256_setzero_pd();
+		__m256d acc = zero;
+		for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			__m256d a = _mm256_max_pd(_mm256_sub_pd(_mm256_loadu_pd(&(m_low[cDim][start + i])), _mm256_set1_pd(pHigh[cDim])), zero);
+			__m256d b = _mm256_max_pd(_mm256_sub_pd(_mm256_set1_pd(pLow[cDim]), _mm256_loadu_pd(&(m_high[cDim][start + i]))), zero);
+			__m256d d = _mm256_add_pd(a, b);
+			acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+		}
+		_mm256_storeu_pd(out + i, acc);
+	}
+#endif
+
+	// scalar tail, or everything without AVX. The loops are laid out so that
+	// the compiler can vectorize them with whatever it is allowed to use.
+	if (i < count)
+	{
+		for (uint32_t k = i; k < count; ++k) out[k] = 0.0;
+
+		for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			const double* l = &(m_low[cDim][start]);
+			const double* h = &(m_high[cDim][start]);
+			double xl = pLow[cDim];
+			double xh = pHigh[cDim];
+
+			for (uint32_t k = i; k < count; ++k)
+			{
+				double d = std::max(0.0, l[k] - xh) + std::max(0.0, xl - h[k]);
+				out[k] += d * d;
+			}
+		}
+	}
+}
+
+double MBRBuffer::getMinimumDistanceSq(const double* pLow, const double* pHigh, double bound, uint32_t& count) const
+{
+	double dist[BlockSize];
+	double min = std::numeric_limits<double>::max();
+
+	// most scans of a face stop after a few MBRs, so the blocks start small.
+	uint32_t len;
+
+	for (uint32_t start = 0; start < m_size; start += len)
+	{
+		len = std::min(std::min(BlockSize, std::max(4u, start)), m_size - start);
+		getMinimumDistancesSq(pLow, pHigh, start, len, dist);
+		count += len;
+
+		for (uint32_t k = 0; k < len; ++k) min = std::min(min, dist[k]);
+
+		if (min < bound) break;
+	}
+
+	return min;
+}
+
+double MBRBuffer::getHausDistLBSq(const Region& r, double bound, uint32_t& count) const
+{
+	if (r.m_dimension != m_dimension)
+		throw Tools::IllegalArgumentException(
+			"MBRBuffer::getHausDistLBSq: Region has the wrong number of dimensions."
+		);
+
+	std::vector<double> low(m_dimension), high(m_dimension);
+
+	for (uint32_t cFace = 0; cFace < r.getNumberOfFaces(); ++cFace)
+	{
+		r.getFace(cFace, &low[0], &high[0]);
+		bound = std::max(bound, getMinimumDistanceSq(&low[0], &high[0], bound, count));
+	}
+
+	return bound;
+}
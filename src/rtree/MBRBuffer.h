@@ -0,0 +1,61 @@
+// Spatial Index Library
+//
+// Copyright (C) 2002 Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+#pragma once
+
+namespace SpatialIndex
+{
+	namespace RTree
+	{
+		// The MBRs selected by RTree::selectMBRs, stored as one contiguous array of low
+		// and one of high coordinates per dimension, so that distances from a box to a
+		// run of consecutive MBRs can be computed several at a time.
+		class MBRBuffer
+		{
+		public:
+			MBRBuffer();
+
+			void assign(const std::vector<const Region*>& mbrs, uint32_t dimension);
+			void clear();
+
+			uint32_t size() const { return m_size; }
+			bool empty() const { return m_size == 0; }
+
+			void getMinimumDistancesSq(const double* pLow, const double* pHigh, uint32_t start, uint32_t count, double* out) const;
+				// squared minimum distances from the box [pLow, pHigh] to the MBRs [start, start + count).
+			double getMinimumDistanceSq(const double* pLow, const double* pHigh, double bound, uint32_t& count) const;
+				// squared minimum distance from the box to the closest MBR. The scan stops as soon as an MBR
+				// closer than bound (squared) is found. count is increased by the number of distances computed.
+			double getHausDistLBSq(const Region& r, double bound, uint32_t& count) const;
+				// the same as the square of Region::getHausDistLB(mbrs, sqrt(bound), count): the largest of
+				// bound and, over the faces of r, the squared distance from the face to the closest MBR.
+
+			static const uint32_t BlockSize = 16;
+				// the largest number of distances computed at a time.
+
+		private:
+			uint32_t m_dimension;
+			uint32_t m_size;
+			std::vector<std::vector<double> > m_low;
+			std::vector<std::vector<double> > m_high;
+		}; // MBRBuffer
+	}
+}
@@ -54,6 +54,8 @@ uint32_t Node::getByteArraySize()
 
 int Node::updatePointCount() {
 
+	if (m_pTree->m_bAggregateCounts) return this->m_pointCount;
+
 	if (this->isLeaf()) {
 		this->m_pointCount = this->getChildrenCount();
 		//std::cout << this->m_level << " " << this->m_children << std::endl;
@@ -84,9 +86,6 @@ void Node::loadFromByteArray(const byte* ptr)
 	memcpy(&m_children, ptr, sizeof(uint32_t));
 	ptr += sizeof(uint32_t);
 
-	//memcpy(&m_pointCount, ptr, sizeof(uint32_t));
-	//ptr += sizeof(uint32_t);
-
 	for (uint32_t u32Child = 0; u32Child < m_children; ++u32Child)
 	{
 		m_ptrMBR[u32Child] = m_pTree->m_regionPool.acquire();
@@ -117,6 +116,10 @@ void Node::loadFromByteArray(const byte* ptr)
 		//m_nodeMBR.combineRegion(*(m_ptrMBR[u32Child]));
 	}
 
+	// the subtree counts are part of the entry data.
+	m_pointCount = 0;
+	for (uint32_t u32Child = 0; u32Child < m_children; ++u32Child) m_pointCount += getEntryCount(u32Child);
+
 	memcpy(m_nodeMBR.m_pLow, ptr, m_pTree->m_dimension * sizeof(double));
 	ptr += m_pTree->m_dimension * sizeof(double);
 	memcpy(m_nodeMBR.m_pHigh, ptr, m_pTree->m_dimension * sizeof(double));
@@ -144,9 +147,6 @@ void Node::storeToByteArray(byte** data, uint32_t& len)
 	memcpy(ptr, &m_children, sizeof(uint32_t));
 	ptr += sizeof(uint32_t);
 
-	//memcpy(ptr, &m_pointCount, sizeof(uint32_t));
-	//ptr += sizeof(uint32_t);
-
 	for (uint32_t u32Child = 0; u32Child < m_children; ++u32Child)
 	{
 		memcpy(ptr, m_ptrMBR[u32Child]->m_pLow, m_pTree->m_dimension * sizeof(double));
@@ -245,6 +245,7 @@ bool Node::isIndex() const
 //
 
 Node::Node() :
+	m_pointCount(0),
 	m_pTree(0),
 	m_level(0),
 	m_identifier(-1),
@@ -259,6 +260,7 @@ Node::Node() :
 }
 
 Node::Node(SpatialIndex::RTree::RTree* pTree, id_type id, uint32_t level, uint32_t capacity) :
+	m_pointCount(0),
 	m_pTree(pTree),
 	m_level(level),
 	m_identifier(id),
@@ -322,6 +324,7 @@ void Node::insertEntry(uint32_t dataLength, byte* pData, Region& mbr, id_type id
 	m_pIdentifier[m_children] = id;
 
 	m_totalDataLength += dataLength;
+	m_pointCount += getEntryCount(m_children);
 	++m_children;
 
 	m_nodeMBR.combineRegion(mbr);
@@ -335,6 +338,7 @@ void Node::deleteEntry(uint32_t index)
 	RegionPtr ptrR = m_ptrMBR[index];
 
 	m_totalDataLength -= m_pDataLength[index];
+	m_pointCount -= getEntryCount(index);
 	if (m_pData[index] != 0) delete[] m_pData[index];
 
 	if (m_children > 1 && index != m_children - 1)
@@ -369,6 +373,50 @@ void Node::deleteEntry(uint32_t index)
 	}
 }
 
+uint32_t Node::getEntryCount(uint32_t index) const
+{
+	if (m_level == 0) return 1;
+	if (m_pDataLength[index] != sizeof(uint32_t)) return 0;
+
+	uint32_t count;
+	memcpy(&count, m_pData[index], sizeof(uint32_t));
+	return count;
+}
+
+void Node::setEntryCount(uint32_t index, uint32_t count)
+{
+	assert(m_level != 0);
+
+	if (m_pDataLength[index] != sizeof(uint32_t))
+	{
+		m_totalDataLength -= m_pDataLength[index];
+		if (m_pData[index] != 0) delete[] m_pData[index];
+
+		m_pDataLength[index] = sizeof(uint32_t);
+		m_pData[index] = new byte[sizeof(uint32_t)];
+		bzero(m_pData[index], sizeof(uint32_t));
+		m_totalDataLength += sizeof(uint32_t);
+	}
+
+	m_pointCount += static_cast<int>(count) - static_cast<int>(getEntryCount(index));
+	memcpy(m_pData[index], &count, sizeof(uint32_t));
+}
+
+void Node::getCountData(uint32_t& len, byte** data) const
+{
+	if (! m_pTree->m_bAggregateCounts)
+	{
+		len = 0;
+		*data = 0;
+		return;
+	}
+
+	uint32_t count = m_pointCount;
+	len = sizeof(uint32_t);
+	*data = new byte[sizeof(uint32_t)];
+	memcpy(*data, &count, sizeof(uint32_t));
+}
+
 bool Node::insertData(uint32_t dataLength, byte* pData, Region& mbr, id_type id, std::stack<id_type>& pathBuffer, byte* overflowTable)
 {
 	if (m_children < m_capacity)
@@ -381,7 +429,8 @@ bool Node::insertData(uint32_t dataLength, byte* pData, Region& mbr, id_type id,
 		insertEntry(dataLength, pData, mbr, id);
 		m_pTree->writeNode(this);
 
-		if ((! b) && (! pathBuffer.empty()))
+		// subtree counts change on every insertion, so the path has to be adjusted anyway.
+		if ((! b || m_pTree->m_bAggregateCounts) && (! pathBuffer.empty()))
 		{
 			id_type cParent = pathBuffer.top(); pathBuffer.pop();
 			NodePtr ptrN = m_pTree->readNode(cParent);
@@ -465,8 +514,13 @@ bool Node::insertData(uint32_t dataLength, byte* pData, Region& mbr, id_type id,
 		m_pIdentifier = keepid;
 		m_children = lKeep;
 		m_totalDataLength = 0;
+		m_pointCount = 0;
 
-		for (uint32_t u32Child = 0; u32Child < m_children; ++u32Child) m_totalDataLength += m_pDataLength[u32Child];
+		for (uint32_t u32Child = 0; u32Child < m_children; ++u32Child)
+		{
+			m_totalDataLength += m_pDataLength[u32Child];
+			m_pointCount += getEntryCount(u32Child);
+		}
 
 		for (uint32_t cDim = 0; cDim < m_nodeMBR.m_dimension; ++cDim)
 		{
@@ -533,8 +587,12 @@ bool Node::insertData(uint32_t dataLength, byte* pData, Region& mbr, id_type id,
 				ptrR->m_nodeMBR = m_pTree->m_infiniteRegion;
 			}
 
-			ptrR->insertEntry(0, 0, n->m_nodeMBR, n->m_identifier);
-			ptrR->insertEntry(0, 0, nn->m_nodeMBR, nn->m_identifier);
+			uint32_t len;
+			byte* data;
+			n->getCountData(len, &data);
+			ptrR->insertEntry(len, data, n->m_nodeMBR, n->m_identifier);
+			nn->getCountData(len, &data);
+			ptrR->insertEntry(len, data, nn->m_nodeMBR, nn->m_identifier);
 
 			m_pTree->writeNode(ptrR.get());
 
@@ -1072,6 +1130,7 @@ void Node::condenseTree(std::stack<NodePtr>& toReinsert, std::stack<id_type>& pa
 		{
 			// adjust the entry in 'p' to contain the new bounding region of this node.
 			*(p->m_ptrMBR[child]) = m_nodeMBR;
+			if (m_pTree->m_bAggregateCounts) p->setEntryCount(child, m_pointCount);
 
 			// global recalculation necessary since the MBR can only shrink in size,
 			// due to data removal.
@@ -78,6 +78,12 @@ namespace SpatialIndex
 			virtual void insertEntry(uint32_t dataLength, byte* pData, Region& mbr, id_type id);
 			virtual void deleteEntry(uint32_t index);
 
+			uint32_t getEntryCount(uint32_t index) const;
+			void setEntryCount(uint32_t index, uint32_t count);
+			void getCountData(uint32_t& len, byte** data) const;
+				// With AggregateCounts the data of an index entry is the number of data entries
+				// in the subtree it points to, stored as a uint32_t.
+
 			virtual bool insertData(uint32_t dataLength, byte* pData, Region& mbr, id_type id, std::stack<id_type>& pathBuffer, byte* overflowTable);
 			virtual void reinsertData(uint32_t dataLength, byte* pData, Region& mbr, id_type id, std::vector<uint32_t>& reinsert, std::vector<uint32_t>& keep);
 
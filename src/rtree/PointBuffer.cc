@@ -0,0 +1,196 @@
+// Spatial Index Library
+//
+// Copyright (C) 2002 Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include "../spatialindex/SpatialIndexImpl.h"
+#include "PointBuffer.h"
+
+using namespace SpatialIndex::RTree;
+
+const uint32_t PointBuffer::BlockSize;
+
+PointBuffer::PointBuffer() : m_dimension(0), m_bPositions(false)
+{
+}
+
+PointBuffer::PointBuffer(const PointBuffer& b, const std::vector<uint32_t>& order) :
+	m_dimension(b.m_dimension),
+	m_coords(b.m_dimension, std::vector<double>(order.size())),
+	m_ids(order.size()),
+	m_bPositions(false)
+{
+	for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+	{
+		for (uint32_t i = 0; i < order.size(); ++i) m_coords[cDim][i] = b.m_coords[cDim][order[i]];
+	}
+
+	for (uint32_t i = 0; i < order.size(); ++i) m_ids[i] = b.m_ids[order[i]];
+}
+
+void PointBuffer::clear(uint32_t dimension)
+{
+	m_dimension = dimension;
+	m_coords.assign(dimension, std::vector<double>());
+	m_ids.clear();
+	m_positions.clear();
+	m_bPositions = false;
+}
+
+void PointBuffer::push_back(const double* pCoords, id_type id)
+{
+	if (m_bPositions) m_positions.insert(std::make_pair(id, size()));
+
+	for (uint32_t cDim = 0; cDim < m_dimension; ++cDim) m_coords[cDim].push_back(pCoords[cDim]);
+	m_ids.push_back(id);
+}
+
+bool PointBuffer::remove(const double* pCoords, id_type id, uint32_t& index)
+{
+	if (! m_bPositions) buildPositions();
+
+	std::pair<PositionMap::iterator, PositionMap::iterator> range = m_positions.equal_range(id);
+
+	for (PositionMap::iterator it = range.first; it != range.second; ++it)
+	{
+		uint32_t i = it->second;
+
+		uint32_t cDim = 0;
+		while (cDim < m_dimension && m_coords[cDim][i] == pCoords[cDim]) ++cDim;
+		if (cDim < m_dimension) continue;
+
+		m_positions.erase(it);
+
+		uint32_t last = m_ids.size() - 1;
+		if (i != last)
+		{
+			// the last point moves into the hole, and its entry follows it.
+			range = m_positions.equal_range(m_ids[last]);
+			PositionMap::iterator moved = range.first;
+			while (moved->second != last) ++moved;
+			moved->second = i;
+		}
+
+		for (cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			m_coords[cDim][i] = m_coords[cDim][last];
+			m_coords[cDim].pop_back();
+		}
+		m_ids[i] = m_ids[last];
+		m_ids.pop_back();
+
+		index = i;
+		return true;
+	}
+
+	return false;
+}
+
+void PointBuffer::buildPositions()
+{
+	m_positions.clear();
+	for (uint32_t i = 0; i < m_ids.size(); ++i) m_positions.insert(std::make_pair(m_ids[i], i));
+	m_bPositions = true;
+}
+
+void PointBuffer::getCoordinates(uint32_t index, double* pCoords) const
+{
+	for (uint32_t cDim = 0; cDim < m_dimension; ++cDim) pCoords[cDim] = m_coords[cDim][index];
+}
+
+void PointBuffer::getDistancesSq(const double* p, uint32_t start, uint32_t count, double* out) const
+{
+	uint32_t i = 0;
+
+#if defined(__AVX512F__)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m512d acc = _mm512_setzero_pd();
+		for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			__m512d d = _mm512_sub_pd(_mm512_loadu_pd(&(m_coords[cDim][start + i])), _mm512_set1_pd(p[cDim]));
+			acc = _mm512_add_pd(acc, _mm512_mul_pd(d, d));
+		}
+		_mm512_storeu_pd(out + i, acc);
+	}
+#endif
+
+#if defined(__AVX__)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m256d acc = _mm256_setzero_pd();
+		for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			__m256d d = _mm256_sub_pd(_mm256_loadu_pd(&(m_coords[cDim][start + i])), _mm256_set1_pd(p[cDim]));
+			acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+		}
+		_mm256_storeu_pd(out + i, acc);
+	}
+#endif
+
+	// scalar tail, or everything without AVX. The loops are laid out so that
+	// the compiler can vectorize them with whatever it is allowed to use.
+	if (i < count)
+	{
+		for (uint32_t k = i; k < count; ++k) out[k] = 0.0;
+
+		for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			const double* c = &(m_coords[cDim][start]);
+			double x = p[cDim];
+			for (uint32_t k = i; k < count; ++k) out[k] += (c[k] - x) * (c[k] - x);
+		}
+	}
+}
+
+double PointBuffer::getNearestSq(const double* p, double bound, uint32_t& nnpos, uint32_t& count) const
+{
+	double dist[BlockSize];
+	double min = std::numeric_limits<double>::max();
+	uint32_t n = size();
+
+	nnpos = 0;
+	count = 0;
+
+	for (uint32_t start = 0; start < n; start += BlockSize)
+	{
+		uint32_t len = std::min(BlockSize, n - start);
+		getDistancesSq(p, start, len, dist);
+		count += len;
+
+		for (uint32_t k = 0; k < len; ++k)
+		{
+			if (dist[k] < min)
+			{
+				min = dist[k];
+				nnpos = start + k;
+			}
+		}
+
+		if (min < bound) break;
+	}
+
+	return min;
+}
@@ -0,0 +1,76 @@
+// Spatial Index Library
+//
+// Copyright (C) 2002 Navel Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Email:
+//    mhadji@gmail.com
+
+#pragma once
+
+namespace SpatialIndex
+{
+	namespace RTree
+	{
+		// An in-memory snapshot of the data points of a tree, stored as one
+		// contiguous array per dimension so that distances from a point to a
+		// run of consecutive points can be computed several at a time.
+		class PointBuffer
+		{
+		public:
+			PointBuffer();
+			PointBuffer(const PointBuffer& b, const std::vector<uint32_t>& order);
+				// a copy of b with its points rearranged, point i being b's point order[i].
+
+			void clear(uint32_t dimension);
+			void push_back(const double* pCoords, id_type id);
+			bool remove(const double* pCoords, id_type id, uint32_t& index);
+				// removes a point with these coordinates and id, moving the last point into its place,
+				// which index receives. The first call indexes the points by id, and push_back keeps
+				// the index from then on.
+
+			uint32_t size() const { return static_cast<uint32_t>(m_ids.size()); }
+			bool empty() const { return m_ids.empty(); }
+			uint32_t getDimension() const { return m_dimension; }
+
+			double getCoordinate(uint32_t index, uint32_t dim) const { return m_coords[dim][index]; }
+			void getCoordinates(uint32_t index, double* pCoords) const;
+			id_type getIdentifier(uint32_t index) const { return m_ids[index]; }
+
+			void getDistancesSq(const double* p, uint32_t start, uint32_t count, double* out) const;
+				// squared distances from p to the points [start, start + count).
+			double getNearestSq(const double* p, double bound, uint32_t& nnpos, uint32_t& count) const;
+				// squared distance from p to its nearest point, stored in nnpos. The scan stops as soon as a
+				// point closer than bound (squared) is found. count receives the number of distances computed.
+
+			static const uint32_t BlockSize = 16;
+				// the number of distances computed at a time.
+
+		private:
+			typedef std::multimap<id_type, uint32_t> PositionMap;
+
+			void buildPositions();
+
+			uint32_t m_dimension;
+			std::vector<std::vector<double> > m_coords;
+			std::vector<id_type> m_ids;
+
+			PositionMap m_positions;
+				// the position of every point by id, once remove has been called.
+			bool m_bPositions;
+		}; // PointBuffer
+	}
+}
@@ -100,6 +100,7 @@ namespace Tools
 					p->m_identifier = -1;
 					p->m_children = 0;
 					p->m_totalDataLength = 0;
+					p->m_pointCount = 0;
 
 					m_pool.push(p);
 				}
@@ -120,6 +121,16 @@ namespace Tools
 		{
 			assert (c >= 0);
 			m_capacity = c;
+
+			// drop the pointers that do not fit any more.
+			while (m_pool.size() > m_capacity)
+			{
+				RTree::Node* x = m_pool.top(); m_pool.pop();
+				#ifndef NDEBUG
+				--m_pointerCount;
+				#endif
+				delete x;
+			}
 		}
 
 	protected:
@@ -137,14 +137,15 @@ SpatialIndex::ISpatialIndex* SpatialIndex::RTree::returnRTree(SpatialIndex::ISto
 	return si;
 }
 
-SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createNewRTree(
+static SpatialIndex::ISpatialIndex* createNewRTree_impl(
 		SpatialIndex::IStorageManager& sm,
 		double fillFactor,
 		uint32_t indexCapacity,
 		uint32_t leafCapacity,
 		uint32_t dimension,
-		RTreeVariant rv,
-		id_type& indexIdentifier)
+		SpatialIndex::RTree::RTreeVariant rv,
+		bool bAggregateCounts,
+		SpatialIndex::id_type& indexIdentifier)
 {
 	Tools::Variant var;
 	Tools::PropertySet ps;
@@ -169,7 +170,11 @@ SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createNewRTree(
 	var.m_val.lVal = rv;
 	ps.setProperty("TreeVariant", var);
 
-	ISpatialIndex* ret = returnRTree(sm, ps);
+	var.m_varType = Tools::VT_BOOL;
+	var.m_val.blVal = bAggregateCounts;
+	ps.setProperty("AggregateCounts", var);
+
+	SpatialIndex::ISpatialIndex* ret = SpatialIndex::RTree::returnRTree(sm, ps);
 
 	var.m_varType = Tools::VT_LONGLONG;
 	var = ps.getProperty("IndexIdentifier");
@@ -178,6 +183,18 @@ SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createNewRTree(
 	return ret;
 }
 
+SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createNewRTree(
+		SpatialIndex::IStorageManager& sm,
+		double fillFactor,
+		uint32_t indexCapacity,
+		uint32_t leafCapacity,
+		uint32_t dimension,
+		RTreeVariant rv,
+		id_type& indexIdentifier)
+{
+	return createNewRTree_impl(sm, fillFactor, indexCapacity, leafCapacity, dimension, rv, false, indexIdentifier);
+}
+
 SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createAndBulkLoadNewRTree(
 		BulkLoadMethod m,
 		IDataStream& stream,
@@ -310,7 +327,18 @@ SpatialIndex::ISpatialIndex* SpatialIndex::RTree::createAndBulkLoadNewRTree(
 		numberOfPages = var.m_val.ulVal;
 	}
 
-	SpatialIndex::ISpatialIndex* tree = createNewRTree(sm, fillFactor, indexCapacity, leafCapacity, dimension, rv, indexIdentifier);
+	// aggregate counts
+	bool bAggregateCounts = false;
+	var = ps.getProperty("AggregateCounts");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_BOOL)
+			throw Tools::IllegalArgumentException("createAndBulkLoadNewRTree: Property AggregateCounts must be Tools::VT_BOOL");
+
+		bAggregateCounts = var.m_val.blVal;
+	}
+
+	SpatialIndex::ISpatialIndex* tree = createNewRTree_impl(sm, fillFactor, indexCapacity, leafCapacity, dimension, rv, bAggregateCounts, indexIdentifier);
 
 	uint32_t bindex = static_cast<uint32_t>(std::floor(static_cast<double>(indexCapacity * fillFactor)));
 	uint32_t bleaf = static_cast<uint32_t>(std::floor(static_cast<double>(leafCapacity * fillFactor)));
@@ -355,11 +383,18 @@ SpatialIndex::RTree::RTree::RTree(IStorageManager& sm, Tools::PropertySet& ps) :
 			m_reinsertFactor(0.3),
 			m_dimension(2),
 			m_bTightMBRs(true),
+			m_bAggregateCounts(false),
+			m_workerThreads(1),
+			m_bStableJoinOrder(true),
 			m_pointPool(500),
 			m_regionPool(1000),
 			m_indexPool(100),
 			m_leafPool(100),
-			m_pointCount(0)
+			m_pointCount(0),
+			m_pRootMBR(0),
+			m_summaryMBRs(0),
+			m_coverSelection(CS_AREA),
+			m_summaryCoverSelection(CS_AREA)
 {
 #ifdef HAVE_PTHREAD_H
 	pthread_rwlock_init(&m_rwLock, NULL);
@@ -434,6 +469,8 @@ void SpatialIndex::RTree::RTree::insertData(uint32_t len, const byte* pData, con
 		insertData_impl(len, buffer, *mbr, id);
 		// the buffer is stored in the tree. Do not delete here.
 
+		updateSummaryOnInsert(*mbr, id);
+
 #ifndef HAVE_PTHREAD_H
 		m_rwLock = false;
 #endif
@@ -463,6 +500,7 @@ bool SpatialIndex::RTree::RTree::deleteData(const IShape& shape, id_type id)
 		RegionPtr mbr = m_regionPool.acquire();
 		shape.getMBR(*mbr);
 		bool ret = deleteData_impl(*mbr, id);
+		if (ret) updateSummaryOnDelete(*mbr, id);
 
 #ifndef HAVE_PTHREAD_H
 		m_rwLock = false;
@@ -511,69 +549,90 @@ void SpatialIndex::RTree::RTree::nearestNeighborQuery(uint32_t k, const IShape&
 
 	try
 	{
-		std::priority_queue<NNEntry*, std::vector<NNEntry*>, NNEntry::ascending> queue;
+		// the queue holds plain entries. The leaves whose data entries are queued are kept in
+		// leaves, and a data entry is only copied when it is reported.
+		std::priority_queue<NNQueueEntry, std::vector<NNQueueEntry>, NNQueueEntry::ascending> queue;
+		std::vector<NodePtr> leaves;
+
+		// the default comparator measures data entries by their MBRs, and the distance of a
+		// point to an MBR can be computed directly.
+		bool bMBR = (dynamic_cast<NNComparator*>(&nnc) != 0);
+		const Point* pPoint = (bMBR) ? dynamic_cast<const Point*>(&query) : 0;
 
-		queue.push(new NNEntry(m_rootID, 0, 0.0));
+		queue.push(NNQueueEntry(m_rootID, NNQueueEntry::NoLeaf, 0, 0.0));
 
 		uint32_t count = 0;
 		double knearest = 0.0;
 
-		int counter = 0;
 		while (! queue.empty())
 		{
-			NNEntry* pFirst = queue.top();
+			NNQueueEntry first = queue.top();
 
 			// report all nearest neighbors with equal greatest distances.
 			// (neighbors can be more than k, if many happen to have the same greatest distance).
-			if (count >= k && pFirst->m_minDist > knearest)	break;
+			if (count >= k && first.m_minDist > knearest)	break;
 
 			queue.pop();
 
-			if (pFirst->m_pEntry == 0)
+			if (first.m_leaf == NNQueueEntry::NoLeaf)
 			{
 				// n is a leaf or an index.
-				NodePtr n = readNode(pFirst->m_id);
+				NodePtr n = readNode(first.m_id);
 
 				v.setDistance(3.0);
 				v.visitNode(*n);
 
-				for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+				if (n->m_level == 0)
 				{
-					if (n->m_level == 0)
+					uint32_t leaf = leaves.size();
+					leaves.push_back(n);
+
+					for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
 					{
-						Data* e = new Data(n->m_pDataLength[cChild], n->m_pData[cChild], *(n->m_ptrMBR[cChild]), n->m_pIdentifier[cChild]);
-						// we need to compare the query with the actual data entry here, so we call the
-						// appropriate getMinimumDistance method of NearestNeighborComparator.
-						queue.push(new NNEntry(n->m_pIdentifier[cChild], e, nnc.getMinimumDistance(query, *e)));
+						double d;
+
+						if (pPoint != 0)
+						{
+							d = n->m_ptrMBR[cChild]->getMinimumDistance(*pPoint);
+						}
+						else if (bMBR)
+						{
+							d = query.getMinimumDistance(*(n->m_ptrMBR[cChild]));
+						}
+						else
+						{
+							// we need to compare the query with the actual data entry here, so we call the
+							// appropriate getMinimumDistance method of NearestNeighborComparator.
+							Data e(n->m_pDataLength[cChild], n->m_pData[cChild], *(n->m_ptrMBR[cChild]), n->m_pIdentifier[cChild]);
+							d = nnc.getMinimumDistance(query, e);
+						}
+
+						queue.push(NNQueueEntry(n->m_pIdentifier[cChild], leaf, cChild, d));
 					}
-					else
+				}
+				else
+				{
+					for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
 					{
-						queue.push(new NNEntry(n->m_pIdentifier[cChild], 0, nnc.getMinimumDistance(query, *(n->m_ptrMBR[cChild]))));
+						double d = (pPoint != 0) ? n->m_ptrMBR[cChild]->getMinimumDistance(*pPoint) : nnc.getMinimumDistance(query, *(n->m_ptrMBR[cChild]));
+						queue.push(NNQueueEntry(n->m_pIdentifier[cChild], NNQueueEntry::NoLeaf, 0, d));
 					}
 				}
 				v.incNumDistCals(n->m_children);
 			}
 			else
 			{
-				v.visitData(*(static_cast<IData*>(pFirst->m_pEntry)));
+				const NodePtr& n = leaves[first.m_leaf];
+				Data e(n->m_pDataLength[first.m_child], n->m_pData[first.m_child], *(n->m_ptrMBR[first.m_child]), first.m_id);
+
+				v.visitData(e);
 				++(m_stats.m_u64QueryResults);
 				++count;
-				knearest = pFirst->m_minDist;
+				knearest = first.m_minDist;
 
 				v.setDistance(knearest);
-				m_point_id = pFirst->m_pEntry->getIdentifier();
-
-				delete pFirst->m_pEntry;
+				m_point_id = first.m_id;
 			}
-
-			delete pFirst;
-		}
-
-		while (! queue.empty())
-		{
-			NNEntry* e = queue.top(); queue.pop();
-			if (e->m_pEntry != 0) delete e->m_pEntry;
-			delete e;
 		}
 
 #ifndef HAVE_PTHREAD_H
@@ -597,12 +656,34 @@ void SpatialIndex::RTree::RTree::nearestNeighborQuery(uint32_t k, const IShape&
 }
 
 /*
+ *  Mode -4: Actual Hausdorff distance, early break with Z-order over m_pointBuffer.
+ *  Mode -3: Actual Hausdorff distance, early break with random order over m_pointBuffer.
+ *  Mode -2: Actual Hausdorff distance, dual-tree branch and bound.
+ *  Mode -1: Actual Hausdorff distance, all nearest neighbor join.
  * 	Mode 0: Actual Hausdorff distance
  *  Mode 1: Lower bound computed from Root MBRs of the object and the query rtree.
  *  Mode 2: Lower bound computed from immediate children of the roots.
  *  Mode 3: Just Mindist.
+ *
+ *  Modes 1 and 2 fall back to the next cheaper bound when selectMBRs has not been
+ *  called on both trees, so that every mode is safe to use on any pair of trees.
+ */
+
+/*
+ *  The distance of every mode when either tree has no points: 0 if this tree has
+ *  none, and DBL_MAX if only the query is empty, since no point of the query is
+ *  near the points of this tree. Returns false if both trees have points.
  */
 
+bool SpatialIndex::RTree::RTree::getEmptyDistance(const RTree& query, double& dist) const
+{
+	if (m_stats.m_u64Data == 0) dist = 0.0;
+	else if (query.m_stats.m_u64Data == 0) dist = std::numeric_limits<double>::max();
+	else return false;
+
+	return true;
+}
+
 double SpatialIndex::RTree::RTree::hausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v)
 {
 	double retDist;
@@ -610,204 +691,334 @@ double SpatialIndex::RTree::RTree::hausdorff(ISpatialIndex& query, uint64_t& id1
 	//std::cout << "============" << std::endl;
 	//std::cout << *queryRTreePtr << std::endl;
 
+	if (mode < -4 || mode > 3) throw Tools::IllegalArgumentException("hausdorff: unknown mode.");
+	if (getEmptyDistance(*queryRTreePtr, retDist)) return retDist;
+
 
-	if (mode==-1) {
+	if (mode==-4) {
+		retDist = this->hausdorffEarlyBreak(*queryRTreePtr, id1, id2, true, 0.0, std::numeric_limits<double>::max(), 0, 0, v);
+	} else if (mode==-3) {
+		retDist = this->hausdorffEarlyBreak(*queryRTreePtr, id1, id2, false, 0.0, std::numeric_limits<double>::max(), 0, 0, v);
+	} else if (mode==-2) {
+		retDist = this->hausdorffDualTree(*queryRTreePtr, id1, id2, 0.0, v);
+	} else if (mode==-1) {
 		retDist = this->hausdorff(query, id1, id2, v);
 	} else if (mode==0) {
-		retDist = this->hausdorff2(query, id1, id2, v);
-	} else if (mode==1) {
+		retDist = this->hausdorff2(query, id1, id2, m_workerThreads, v);
+	} else if ((mode==1 || mode==2) && (m_pRootMBR == 0 || queryRTreePtr->m_pRootMBR == 0)) {
+		retDist = this->hausdorff(query, id1, id2, 3, v);
+	} else if (mode==1 || (mode==2 && (m_vec_pMBR.empty() || queryRTreePtr->m_vec_pMBR.empty()))) {
 		//NodePtr root1 = readNode(this->m_rootID);
 		//NodePtr root2 = queryRTreePtr->readNode(queryRTreePtr->m_rootID);
 		//retDist = root1->m_nodeMBR.getHausDistLB(root2->m_nodeMBR);
 		retDist = m_pRootMBR->getHausDistLB(*(queryRTreePtr->m_pRootMBR));
-		v.incNumDistCals(4);
+		v.incNumDistCals(m_pRootMBR->getNumberOfFaces());
 
 	} else if (mode==2) {
-		double max = std::numeric_limits<double>::min();
+		double max = 0.0;
 
-		//Region r = Region(2);
-
-		int counter = 0;
+		uint32_t counter = 0;
 		for (int i=this->m_vec_pMBR.size()-1; i>=0; i--) {
-			//this->m_vec_pMBR[i]->getMBR(r);
-			max = this->m_vec_pMBR[i]->getHausDistLB(queryRTreePtr->m_vec_pMBR,max,counter);
-			//max = std::max(max,r.getHausDistLB(queryRTreePtr->m_vec_pMBR,max,counter));
-
+			max = queryRTreePtr->m_packedMBRs.getHausDistLBSq(*(this->m_vec_pMBR[i]), max, counter);
 		}
 
 		v.incNumDistCals(counter);
 
 
-		retDist = max;
+		retDist = std::sqrt(max);
 	} else if (mode==3) {
 		NodePtr root1 = readNode(this->m_rootID);
 		NodePtr root2 = queryRTreePtr->readNode(queryRTreePtr->m_rootID);
 		retDist = root1->m_nodeMBR.getMinimumDistance(root2->m_nodeMBR);
+	} else {
+		throw Tools::IllegalArgumentException("hausdorff: unknown mode.");
 	}
 
 	return retDist;
 }
 
-double SpatialIndex::RTree::RTree::hausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, IVisitor& v)
+// The largest distance passed by allNearestNeighborJoin, for mode -1 of hausdorff.
+class MaxNearestDistance : public SpatialIndex::IPairVisitor
 {
+public:
+	MaxNearestDistance() : m_max(0.0), m_id1(-1), m_id2(-1) {}
 
-#ifdef HAVE_PTHREAD_H
-	Tools::SharedLock lock(&m_rwLock);
-#else
-	if (m_rwLock == false) m_rwLock = true;
-	else throw Tools::ResourceLockedException("nearestNeighborQuery: cannot acquire a shared lock");
-#endif
-
-	try {
-		// COMPUTE HAUSDORFF HERE
-		std::queue<id_type> node_queue;
-
-		float hausdorff = 0.0;
-		node_queue.push(m_rootID);
-		while (! node_queue.empty())
+	void visitPair(SpatialIndex::id_type id1, SpatialIndex::id_type id2, double distance)
+	{
+		if (distance > m_max || m_id1 == -1)
 		{
-			id_type top = node_queue.front();
-			node_queue.pop();
-			NodePtr n = readNode(top);
-			for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
-			{
-				if (n->m_level == 0)
-				{
-					Point p = Point(n->m_ptrMBR[cChild]->m_pLow,2);
-
-					query.nearestNeighborQuery(1, p, v);
-					if (v.getDistance() > hausdorff) {
-						hausdorff = v.getDistance();
-						id1 = n->m_pIdentifier[cChild];
-						id2 = query.m_point_id;
-					}
-				}
-				else {
-					node_queue.push(n->m_pIdentifier[cChild]);
-				}
-			}
+			m_max = distance;
+			m_id1 = id1;
+			m_id2 = id2;
 		}
-		return hausdorff;
-
-#ifndef HAVE_PTHREAD_H
-m_rwLock = false;
-#endif
 	}
-	catch (...)
+
+	double m_max;
+	SpatialIndex::id_type m_id1;
+	SpatialIndex::id_type m_id2;
+}; // MaxNearestDistance
+
+// Every pair passed by allNearestNeighborJoin, for mode -1 of mhausdorff.
+class NearestDistances : public SpatialIndex::IPairVisitor
+{
+public:
+	void visitPair(SpatialIndex::id_type id1, SpatialIndex::id_type id2, double distance)
 	{
-#ifndef HAVE_PTHREAD_H
-		m_rwLock = false;
-#endif
-		throw;
+		m_dist.push_back(distance);
+		m_id1.push_back(id1);
+		m_id2.push_back(id2);
 	}
-}
 
+	std::vector<double> m_dist;
+	std::vector<SpatialIndex::id_type> m_id1;
+	std::vector<SpatialIndex::id_type> m_id2;
+}; // NearestDistances
 
-double SpatialIndex::RTree::RTree::mhausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v)
+// The point whose nearest neighbor distance is the closest to the average.
+static uint32_t getMHDWitness(const std::vector<double>& nearest, double ave)
 {
-	double retDist;
-	RTree *queryRTreePtr = dynamic_cast<RTree*>(&query);
+	uint32_t ret = 0;
+	double minDiff = std::numeric_limits<double>::max();
 
-	//std::cout << *queryRTreePtr << std::endl;
+	for (uint32_t i = 0; i < nearest.size(); ++i)
+	{
+		double diff = std::abs(ave - nearest[i]);
+		if (diff < minDiff)
+		{
+			minDiff = diff;
+			ret = i;
+		}
+	}
 
+	return ret;
+}
 
-	if (mode==-1) {
-		retDist = this->mhausdorff(query, id1, id2, v);
-	} else if (mode == 0) {
-		retDist = this->mhausdorff2(query, id1, id2, v);
-	} else if (mode==1) {
-		//NodePtr root1 = readNode(this->m_rootID);
-		//NodePtr root2 = queryRTreePtr->readNode(queryRTreePtr->m_rootID);
-		//retDist = root1->m_nodeMBR.getMHausDistLB(root2->m_nodeMBR);
-		retDist = m_pRootMBR->getMHausDistLB(*(queryRTreePtr->m_pRootMBR));
+double SpatialIndex::RTree::RTree::hausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, IVisitor& v)
+{
+	RTree* q = dynamic_cast<RTree*>(&query);
+	if (q == 0) throw Tools::IllegalArgumentException("hausdorff: the query must be an RTree.");
 
-		v.incNumDistCals(1);
-	} else if (mode==2) {
-		double max = std::numeric_limits<double>::min();
+	MaxNearestDistance max;
+	allNearestNeighborJoin(*q, max, v);
 
-		//Region r = Region(2);
-		float weighted_dist = 0.0;
-		int total_pointCount = 0;
-		for (int i=this->m_vec_pMBR.size()-1; i>=0; i--) {
-			//this->m_vec_pMBR[i]->getMBR(r);
-			//weighted_dist += r.getMHausDistLB(queryRTreePtr->m_vec_pMBR,max) * this->m_vec_pointCount[i];
-			weighted_dist += this->m_vec_pMBR[i]->getMHausDistLB(queryRTreePtr->m_vec_pMBR,max) * this->m_vec_pointCount[i];
-			total_pointCount += this->m_vec_pointCount[i];
-		}
-		v.incNumDistCals(m_vec_pMBR.size()*queryRTreePtr->m_vec_pMBR.size());
+	if (max.m_id1 != -1)
+	{
+		id1 = max.m_id1;
+		id2 = max.m_id2;
+	}
 
-		if (this->m_vec_point.size() != total_pointCount) {
-			std::cout << "Point counts don't match!!" << std::endl;
-		}
+	v.setDistance(max.m_max);
+	return max.m_max;
+}
 
+/*
+ *  Auxiliary distances of the dual-tree traversal. All of them return
+ *  squared distances and work for any number of dimensions.
+ */
 
-		//std::cout << this->m_pointCount << std::endl;
-		retDist = weighted_dist / this->m_pointCount;
+// MinMaxDist from a point to an MBR [Roussopoulos, Kelley, Vincent 'Nearest Neighbor Queries',
+// SIGMOD 1995]. Every face of a tight MBR touches a point, so the nearest neighbor of p
+// inside r is never farther than this.
+static double getMinMaxDistanceSq(const double* p, const Region& r)
+{
+	double maxSum = 0.0;
 
-	} else if (mode==3) {
-		NodePtr root1 = readNode(this->m_rootID);
-		NodePtr root2 = queryRTreePtr->readNode(queryRTreePtr->m_rootID);
-		retDist = root1->m_nodeMBR.getMinimumDistance(root2->m_nodeMBR);
+	for (uint32_t cDim = 0; cDim < r.m_dimension; ++cDim)
+	{
+		double rM = (p[cDim] >= (r.m_pLow[cDim] + r.m_pHigh[cDim]) / 2.0) ? r.m_pLow[cDim] : r.m_pHigh[cDim];
+		maxSum += (p[cDim] - rM) * (p[cDim] - rM);
 	}
 
-	return retDist;
-}
+	double ret = std::numeric_limits<double>::max();
 
-void SpatialIndex::RTree::RTree::updatePointCount() {
-	NodePtr root = readNode(this->m_rootID);
-	this->m_pointCount = root->updatePointCount();
+	for (uint32_t cDim = 0; cDim < r.m_dimension; ++cDim)
+	{
+		double rm = (p[cDim] <= (r.m_pLow[cDim] + r.m_pHigh[cDim]) / 2.0) ? r.m_pLow[cDim] : r.m_pHigh[cDim];
+		double rM = (p[cDim] >= (r.m_pLow[cDim] + r.m_pHigh[cDim]) / 2.0) ? r.m_pLow[cDim] : r.m_pHigh[cDim];
+		double d = maxSum - (p[cDim] - rM) * (p[cDim] - rM) + (p[cDim] - rm) * (p[cDim] - rm);
+		ret = std::min(ret, d);
+	}
+
+	return ret;
 }
 
+static double getMinMaxDistanceSq(const Region& a, const Region& r)
+{
+	return getMinMaxDistanceSq(a.m_pLow, r);
+}
 
+template <uint32_t D>
+static double getMinMaxDistanceSq(const RegionN<D>& a, const Region& r)
+{
+	return a.getMinMaxDistanceSq(r);
+}
 
+/*
+ *  Mode -2: Dual-tree branch and bound.
+ *
+ *  Entries of this tree are kept in a max-heap on an upper bound of the
+ *  directed distance of the points below them. Each one carries the entries
+ *  of the query tree that may still hold the nearest neighbor of those points.
+ *  Subtrees whose upper bound cannot raise the current maximum are discarded
+ *  without being read, and the candidate lists are refined on the way down
+ *  so that the query tree is never searched from its root twice.
+ *
+ *  The bounds assume point data and tight MBRs (EnsureTightMBRs), as the
+ *  other Hausdorff modes do.
+ *
+ *  If bound is positive only distances above it are looked for: the result
+ *  is max(bound, h) and id1, id2 are left untouched when h <= bound.
+ */
 
-double SpatialIndex::RTree::RTree::mhausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, IVisitor& v)
+double SpatialIndex::RTree::RTree::hausdorffDualTree(RTree& query, uint64_t& id1, uint64_t& id2, double bound, IVisitor& v)
 {
+	HausdorffBounds b;
+	hausdorffDualTree(query, bound, 0, b, v);
+
+	if (b.m_id1 != -1)
+	{
+		id1 = b.m_id1;
+		id2 = b.m_id2;
+	}
+
+	return b.m_ub;
+}
+
+/*
+ *  Runs the dual-tree search until the distance is known or pBudget, if given,
+ *  is exhausted. b receives the current interval: the lower bound is the larger
+ *  of the largest nearest neighbor distance found and the largest entry lower
+ *  bound, the upper bound is the larger of that distance and the upper bound at
+ *  the top of the heap. m_id1, m_id2 hold the pair of the distance found, or -1.
+ */
 
+void SpatialIndex::RTree::RTree::hausdorffDualTree(RTree& query, double bound, const HausdorffBudget* pBudget, HausdorffBounds& b, IVisitor& v)
+{
 #ifdef HAVE_PTHREAD_H
 	Tools::SharedLock lock(&m_rwLock);
 #else
 	if (m_rwLock == false) m_rwLock = true;
-	else throw Tools::ResourceLockedException("nearestNeighborQuery: cannot acquire a shared lock");
+	else throw Tools::ResourceLockedException("hausdorffDualTree: cannot acquire a shared lock");
 #endif
 
-	try {
-		// COMPUTE HAUSDORFF HERE
-		std::queue<id_type> node_queue;
+	std::priority_queue<HausdorffPair*, std::vector<HausdorffPair*>, HausdorffPair::descending> queue;
 
-		float hausdorff = 0.0;
-		float total_dist = 0.0;
-		int point_count = 0;
-		node_queue.push(m_rootID);
-		while (! node_queue.empty())
+	try
+	{
+		NodeCache cache;
+		bool bExact = true;
+
+		double hausdorff = bound;
+			// the largest exact nearest neighbor distance found so far.
+		double lbMax = bound;
+			// the largest lower bound of any entry. Entries below it cannot hold the answer.
+
+		NodePtr root = readNode(m_rootID);
+		NodePtr qroot = query.readNode(query.m_rootID, cache, v);
+		v.visitNode(*root);
+
+		std::vector<HausdorffEntry> candidates;
+		for (uint32_t cChild = 0; cChild < qroot->m_children; ++cChild)
 		{
-			id_type top = node_queue.front();
-			node_queue.pop();
-			NodePtr n = readNode(top);
-			for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+			candidates.push_back(HausdorffEntry(qroot, cChild));
+		}
+
+		NodePtr n = root;
+		std::vector<HausdorffEntry>* pCandidates = &candidates;
+		HausdorffPair* pFirst = 0;
+
+		while (! candidates.empty())
+		{
+			if (pFirst == 0 || pFirst->m_entry.m_pNode->m_level > 0)
 			{
-				if (n->m_level == 0)
+				// expand an entry of this tree and queue its children.
+				for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
 				{
-					Point p = Point(n->m_ptrMBR[cChild]->m_pLow,2);
-					query.nearestNeighborQuery(1, p, v);
+					HausdorffPair* p = new HausdorffPair(n, cChild);
+					refineHausdorffPair(p, *pCandidates, query, cache, v);
+					lbMax = std::max(lbMax, p->m_lb);
 
-					total_dist += v.getDistance();
-					point_count++;
+					if (p->m_ub > hausdorff && p->m_ub >= lbMax) queue.push(p);
+					else delete p;
 				}
-				else {
-					node_queue.push(n->m_pIdentifier[cChild]);
+			}
+			else
+			{
+				// a single point, look for its nearest neighbor among the candidates only.
+				double dist;
+				id_type nnid;
+
+				if (nearestCandidate(pFirst, hausdorff, dist, nnid, query, cache, v) && dist > hausdorff)
+				{
+					hausdorff = dist;
+					b.m_id1 = pFirst->m_entry.m_pNode->m_pIdentifier[pFirst->m_entry.m_child];
+					b.m_id2 = nnid;
+					lbMax = std::max(lbMax, dist);
+				}
+			}
+
+			delete pFirst;
+			pFirst = 0;
+
+			if (queue.empty()) break;
+
+			if (pBudget != 0)
+			{
+				double lb = std::max(hausdorff, lbMax);
+				double ub = std::max(hausdorff, queue.top()->m_ub);
+
+				if (pBudget->isExhausted(lb, ub, v))
+				{
+					b.m_lb = lb;
+					b.m_ub = ub;
+					bExact = false;
+					break;
 				}
 			}
+
+			pFirst = queue.top(); queue.pop();
+
+			// the heap is ordered on the upper bound, nothing left can raise the maximum.
+			if (pFirst->m_ub <= hausdorff || pFirst->m_ub < lbMax)
+			{
+				delete pFirst;
+				break;
+			}
+
+			if (pFirst->m_entry.m_pNode->m_level > 0)
+			{
+				n = readNode(pFirst->m_entry.m_pNode->m_pIdentifier[pFirst->m_entry.m_child]);
+				v.visitNode(*n);
+			}
+			pCandidates = &(pFirst->m_candidates);
+		}
+
+		while (! queue.empty())
+		{
+			HausdorffPair* p = queue.top(); queue.pop();
+			delete p;
+		}
+
+		if (bExact)
+		{
+			b.m_lb = hausdorff;
+			b.m_ub = hausdorff;
 		}
-		hausdorff = total_dist / point_count;
-		return hausdorff;
+
+		v.setDistance(hausdorff);
 
 #ifndef HAVE_PTHREAD_H
-m_rwLock = false;
+		m_rwLock = false;
 #endif
 	}
 	catch (...)
 	{
+		while (! queue.empty())
+		{
+			HausdorffPair* p = queue.top(); queue.pop();
+			delete p;
+		}
+
 #ifndef HAVE_PTHREAD_H
 		m_rwLock = false;
 #endif
@@ -815,105 +1026,2056 @@ m_rwLock = false;
 	}
 }
 
+/*
+ *  Sets the minimum distance of every candidate from a and returns the
+ *  smallest upper bound they give on the nearest neighbor distance of the
+ *  points of a. TRegion is RegionN<2> or RegionN<3> for the unrolled kernels,
+ *  or Region for any other number of dimensions.
+ */
 
-double SpatialIndex::RTree::RTree::hausdorff2(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, IVisitor& v)
+template <class TRegion>
+double SpatialIndex::RTree::RTree::getCandidateBoundsSq(const TRegion& a, bool bPoint, std::vector<HausdorffEntry>& candidates, const RTree& query) const
 {
-	RTree *queryRTreePtr = dynamic_cast<RTree*>(&query);
+	double ub = std::numeric_limits<double>::max();
 
-	double max = 0;
-	for (int i=0; i< m_vec_point.size(); i++) {
-		Point *p1 = &(m_vec_point.at(i));
-		double min = std::numeric_limits<double>::max();
-		int nnid = -1;
-		for (int j=0; j< queryRTreePtr->m_vec_point.size(); j++) {
-			Point *p2 = &(queryRTreePtr->m_vec_point.at(j));
-			double dist = p1->getMinimumDistance(*p2);
-			v.incNumDistCals(1);
-			//min = std::min(min,dist);
-			if (dist < min) {
-				min = dist;
-				nnid = queryRTreePtr->m_vec_pointID[j];
-			}
+	for (uint32_t cIndex = 0; cIndex < candidates.size(); ++cIndex)
+	{
+		const Region& r = *(candidates[cIndex].m_pNode->m_ptrMBR[candidates[cIndex].m_child]);
+		candidates[cIndex].m_minDist = a.getMinimumDistanceSq(r);
 
-			if (min < max) break;
-		}
+		double d;
+		if (candidates[cIndex].m_pNode->m_level == 0) d = (bPoint) ? candidates[cIndex].m_minDist : a.getMaximumDistanceSq(r);
+		else if (bPoint && query.m_bTightMBRs) d = getMinMaxDistanceSq(a, r);
+		else d = a.getMaximumDistanceSq(r);
 
-		if (min > max) {
-			max = min;
-			id2 = nnid;
-			id1 = this->m_vec_pointID[i];
-		}
-		//max = std::max(max,min);
+		ub = std::min(ub, d);
 	}
-	return max;
+
+	return ub;
 }
 
-double SpatialIndex::RTree::RTree::mhausdorff2(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, IVisitor& v)
+/*
+ *  Computes the bounds of the entry of p and keeps only the candidates that may
+ *  hold a nearest neighbor of one of its points. Candidate nodes are opened
+ *  until they are not above the entry's level, so both trees go down together.
+ */
+
+void SpatialIndex::RTree::RTree::refineHausdorffPair(HausdorffPair* p, const std::vector<HausdorffEntry>& candidates, RTree& query, NodeCache& cache, IVisitor& v)
 {
-	RTree *queryRTreePtr = dynamic_cast<RTree*>(&query);
+	const Region& mbr = *(p->m_entry.m_pNode->m_ptrMBR[p->m_entry.m_child]);
+	uint32_t level = p->m_entry.m_pNode->m_level;
+	bool bPoint = (level == 0);
 
-	double sum = 0;
-	for (int i=0; i< m_vec_point.size(); i++) {
-		Point *p1 = &(m_vec_point.at(i));
-		double min = std::numeric_limits<double>::max();
-		for (int j=0; j< queryRTreePtr->m_vec_point.size(); j++) {
-			Point *p2 = &(queryRTreePtr->m_vec_point.at(j));
-			double dist = p1->getMinimumDistance(*p2);
-			v.incNumDistCals(1);
-			min = std::min(min,dist);
+	// data entries are treated as points, as everywhere else in the Hausdorff code.
+	const double* pHigh = (bPoint) ? mbr.m_pLow : mbr.m_pHigh;
+
+	std::vector<HausdorffEntry> current(candidates);
+	std::vector<HausdorffEntry> next;
+	double ub = std::numeric_limits<double>::max();
+
+	while (true)
+	{
+		double d;
+		if (m_dimension == 2) d = getCandidateBoundsSq(Region2(mbr.m_pLow, pHigh), bPoint, current, query);
+		else if (m_dimension == 3) d = getCandidateBoundsSq(Region3(mbr.m_pLow, pHigh), bPoint, current, query);
+		else d = getCandidateBoundsSq(Region(mbr.m_pLow, pHigh, m_dimension), bPoint, current, query);
+
+		ub = std::min(ub, d);
+		v.incNumDistCals(current.size());
+
+		bool bExpanded = false;
+		next.clear();
+
+		for (uint32_t cIndex = 0; cIndex < current.size(); ++cIndex)
+		{
+			if (current[cIndex].m_minDist > ub) continue;
+
+			uint32_t cLevel = current[cIndex].m_pNode->m_level;
+
+			if (cLevel > level && cLevel > 1)
+			{
+				NodePtr n = query.readNode(current[cIndex].m_pNode->m_pIdentifier[current[cIndex].m_child], cache, v);
+				for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+				{
+					next.push_back(HausdorffEntry(n, cChild));
+				}
+				bExpanded = true;
+			}
+			else
+			{
+				next.push_back(current[cIndex]);
+			}
+		}
+
+		current.swap(next);
+		if (! bExpanded) break;
+	}
+
+	double lb = std::numeric_limits<double>::max();
+
+	if (! bPoint && m_bTightMBRs)
+	{
+		// every face of the entry touches a point, whose nearest neighbor is
+		// at least as far as the closest candidate to that face.
+		lb = 0.0;
+
+		for (uint32_t cDim = 0; cDim < mbr.m_dimension; ++cDim)
+		{
+			double minLow = std::numeric_limits<double>::max();
+			double minHigh = std::numeric_limits<double>::max();
+
+			for (uint32_t cIndex = 0; cIndex < current.size(); ++cIndex)
+			{
+				const Region& r = *(current[cIndex].m_pNode->m_ptrMBR[current[cIndex].m_child]);
+				minLow = std::min(minLow, mbr.getFaceMinimumDistanceSq(2 * cDim, r));
+				minHigh = std::min(minHigh, mbr.getFaceMinimumDistanceSq(2 * cDim + 1, r));
+			}
+
+			lb = std::max(lb, std::max(minLow, minHigh));
+		}
+		v.incNumDistCals(2 * mbr.m_dimension * current.size());
+	}
+	else
+	{
+		for (uint32_t cIndex = 0; cIndex < current.size(); ++cIndex)
+		{
+			lb = std::min(lb, current[cIndex].m_minDist);
+		}
+	}
+
+	if (current.empty()) lb = ub = 0.0;
+
+	p->m_lb = std::sqrt(lb);
+	p->m_ub = std::sqrt(ub);
+	p->m_candidates.swap(current);
+}
+
+/*
+ *  Best-first nearest neighbor search of the point of p restricted to its
+ *  candidates. It stops as soon as a neighbor closer than bound is found,
+ *  since such a point cannot raise the maximum. Returns false if no data
+ *  entry was reached.
+ */
+
+bool SpatialIndex::RTree::RTree::nearestCandidate(HausdorffPair* p, double bound, double& dist, id_type& nnid, RTree& query, NodeCache& cache, IVisitor& v)
+{
+	const double* pt = p->m_entry.m_pNode->m_ptrMBR[p->m_entry.m_child]->m_pLow;
+	Region r(pt, pt, m_dimension);
+	double boundSq = bound * bound;
+
+	std::priority_queue<HausdorffEntry, std::vector<HausdorffEntry>, HausdorffEntry::ascending> heap;
+
+	for (uint32_t cIndex = 0; cIndex < p->m_candidates.size(); ++cIndex)
+	{
+		const HausdorffEntry& e = p->m_candidates[cIndex];
+		if (e.m_pNode->m_level == 0 && e.m_minDist <= boundSq)
+		{
+			dist = std::sqrt(e.m_minDist);
+			nnid = e.m_pNode->m_pIdentifier[e.m_child];
+			return true;
+		}
+		heap.push(e);
+	}
+
+	while (! heap.empty())
+	{
+		HausdorffEntry e = heap.top(); heap.pop();
+
+		if (e.m_pNode->m_level == 0)
+		{
+			dist = std::sqrt(e.m_minDist);
+			nnid = e.m_pNode->m_pIdentifier[e.m_child];
+			return true;
+		}
+
+		NodePtr n = query.readNode(e.m_pNode->m_pIdentifier[e.m_child], cache, v);
+
+		for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+		{
+			HausdorffEntry c(n, cChild);
+			c.m_minDist = r.getMinimumDistanceSq(*(n->m_ptrMBR[cChild]));
+
+			if (n->m_level == 0 && c.m_minDist <= boundSq)
+			{
+				dist = std::sqrt(c.m_minDist);
+				nnid = n->m_pIdentifier[cChild];
+				v.incNumDistCals(cChild + 1);
+				return true;
+			}
+			heap.push(c);
+		}
+		v.incNumDistCals(n->m_children);
+	}
+
+	return false;
+}
+
+/*
+ *  Partial Hausdorff distance: the k-th largest nearest neighbor distance from a point
+ *  of this tree to the query, so k = 1 is h(this, query). The dual-tree search of mode
+ *  -2 is run with the k largest distances found so far in a min-heap, whose top is the
+ *  bound below which entries and points are dropped. k is clamped to the number of
+ *  points. id1, id2 receive the pair at the k-th distance.
+ */
+
+double SpatialIndex::RTree::RTree::partialHausdorff(RTree& query, uint32_t k, uint64_t& id1, uint64_t& id2, IVisitor& v)
+{
+	if (k == 0) throw Tools::IllegalArgumentException("partialHausdorff: k must be positive.");
+
+#ifdef HAVE_PTHREAD_H
+	Tools::SharedLock lock(&m_rwLock);
+#else
+	if (m_rwLock == false) m_rwLock = true;
+	else throw Tools::ResourceLockedException("partialHausdorff: cannot acquire a shared lock");
+#endif
+
+	typedef std::pair<double, std::pair<id_type, id_type> > RankedPair;
+	std::priority_queue<RankedPair, std::vector<RankedPair>, std::greater<RankedPair> > topK;
+	std::priority_queue<HausdorffPair*, std::vector<HausdorffPair*>, HausdorffPair::descending> queue;
+
+	try
+	{
+		double dist;
+		if (getEmptyDistance(query, dist))
+		{
+#ifndef HAVE_PTHREAD_H
+			m_rwLock = false;
+#endif
+			return dist;
+		}
+		if (k > m_stats.m_u64Data) k = static_cast<uint32_t>(m_stats.m_u64Data);
+
+		NodeCache cache;
+		double bound = 0.0;
+			// the k-th largest distance once k have been found, 0 until then.
+
+		NodePtr root = readNode(m_rootID);
+		NodePtr qroot = query.readNode(query.m_rootID, cache, v);
+		v.visitNode(*root);
+
+		std::vector<HausdorffEntry> candidates;
+		for (uint32_t cChild = 0; cChild < qroot->m_children; ++cChild)
+		{
+			candidates.push_back(HausdorffEntry(qroot, cChild));
+		}
+
+		NodePtr n = root;
+		std::vector<HausdorffEntry>* pCandidates = &candidates;
+		HausdorffPair* pFirst = 0;
+
+		while (true)
+		{
+			if (pFirst == 0 || pFirst->m_entry.m_pNode->m_level > 0)
+			{
+				for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+				{
+					HausdorffPair* p = new HausdorffPair(n, cChild);
+					refineHausdorffPair(p, *pCandidates, query, cache, v);
+
+					if (topK.size() < k || p->m_ub > bound) queue.push(p);
+					else delete p;
+				}
+			}
+			else
+			{
+				double dist;
+				id_type nnid;
+
+				if (nearestCandidate(pFirst, bound, dist, nnid, query, cache, v) && (topK.size() < k || dist > bound))
+				{
+					topK.push(RankedPair(dist, std::make_pair(pFirst->m_entry.m_pNode->m_pIdentifier[pFirst->m_entry.m_child], nnid)));
+					if (topK.size() > k) topK.pop();
+					if (topK.size() == k) bound = topK.top().first;
+				}
+			}
+
+			delete pFirst;
+			pFirst = 0;
+
+			if (queue.empty()) break;
+
+			pFirst = queue.top(); queue.pop();
+
+			// the heap is ordered on the upper bound, nothing left can enter the top k.
+			if (topK.size() == k && pFirst->m_ub <= bound)
+			{
+				delete pFirst;
+				break;
+			}
+
+			if (pFirst->m_entry.m_pNode->m_level > 0)
+			{
+				n = readNode(pFirst->m_entry.m_pNode->m_pIdentifier[pFirst->m_entry.m_child]);
+				v.visitNode(*n);
+			}
+			pCandidates = &(pFirst->m_candidates);
+		}
+
+		while (! queue.empty())
+		{
+			HausdorffPair* p = queue.top(); queue.pop();
+			delete p;
+		}
+
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+	}
+	catch (...)
+	{
+		while (! queue.empty())
+		{
+			HausdorffPair* p = queue.top(); queue.pop();
+			delete p;
+		}
+
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+		throw;
+	}
+
+	if (topK.empty()) return 0.0;
+
+	id1 = topK.top().second.first;
+	id2 = topK.top().second.second;
+	v.setDistance(topK.top().first);
+	return topK.top().first;
+}
+
+SpatialIndex::RTree::NodePtr SpatialIndex::RTree::RTree::readNode(id_type page, NodeCache& cache, IVisitor& v)
+{
+	NodeCache::iterator it = cache.find(page);
+	if (it != cache.end()) return it->second;
+
+	NodePtr n = readNode(page);
+	v.visitNode(*n);
+	cache.insert(std::pair<id_type, NodePtr>(page, n));
+	return n;
+}
+
+
+/*
+ *  Symmetric Hausdorff distance max(h(A,B), h(B,A)), with A this tree and B the query.
+ *  id1 always refers to A and id2 to B, whichever direction the pair was found in.
+ *
+ *  Modes -2, -3 and -4 run the second direction with the first distance as a
+ *  bound, so only points of B that are farther than it from A are examined.
+ *  Modes -3 and -4 additionally reuse the distances computed in the first
+ *  direction to skip points of B that are known to be close to A.
+ *  Other modes evaluate both directions independently.
+ */
+
+double SpatialIndex::RTree::RTree::symmetricHausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v)
+{
+	RTree *queryRTreePtr = dynamic_cast<RTree*>(&query);
+	if (queryRTreePtr == 0) throw Tools::IllegalArgumentException("symmetricHausdorff: query is not an RTree.");
+	if (mode < -4 || mode > 3) throw Tools::IllegalArgumentException("symmetricHausdorff: unknown mode.");
+
+	uint64_t rid1 = 0, rid2 = 0;
+	double h, rh;
+
+	if (getEmptyDistance(*queryRTreePtr, h))
+	{
+		queryRTreePtr->getEmptyDistance(*this, rh);
+		h = std::max(h, rh);
+		v.setDistance(h);
+		return h;
+	}
+
+	if (mode == -2)
+	{
+		h = this->hausdorffDualTree(*queryRTreePtr, id1, id2, 0.0, v);
+		rh = queryRTreePtr->hausdorffDualTree(*this, rid1, rid2, h, v);
+	}
+	else if (mode == -3 || mode == -4)
+	{
+		std::vector<double> ub;
+		h = this->hausdorffEarlyBreak(*queryRTreePtr, id1, id2, mode == -4, 0.0, std::numeric_limits<double>::max(), 0, &ub, v);
+		rh = queryRTreePtr->hausdorffEarlyBreak(*this, rid1, rid2, mode == -4, h, std::numeric_limits<double>::max(), &ub, 0, v);
+	}
+	else
+	{
+		h = this->hausdorff(query, id1, id2, mode, v);
+		rh = query.hausdorff(*this, rid1, rid2, mode, v);
+	}
+
+	if (rh > h)
+	{
+		id1 = rid2;
+		id2 = rid1;
+		h = rh;
+	}
+
+	v.setDistance(h);
+	return h;
+}
+
+//
+// Progressive Hausdorff distance
+//
+
+SpatialIndex::RTree::HausdorffBounds::HausdorffBounds() :
+	m_lb(0.0),
+	m_ub(std::numeric_limits<double>::max()),
+	m_id1(-1),
+	m_id2(-1)
+{
+}
+
+SpatialIndex::RTree::RTree::HausdorffBudget::HausdorffBudget(double eps, double timeLimit, uint32_t maxDistCals, IVisitor& v) :
+	m_eps(eps),
+	m_deadline((timeLimit > 0.0) ? Tools::getCurrentTime() + timeLimit : 0.0),
+	m_maxDistCals(maxDistCals),
+	m_startDistCals(v.getNumDistCals())
+{
+}
+
+bool SpatialIndex::RTree::RTree::HausdorffBudget::isExhausted(double lb, double ub, IVisitor& v) const
+{
+	if (ub - lb <= m_eps) return true;
+	if (m_maxDistCals > 0 && static_cast<uint32_t>(v.getNumDistCals() - m_startDistCals) >= m_maxDistCals) return true;
+	if (m_deadline > 0.0 && Tools::getCurrentTime() >= m_deadline) return true;
+	return false;
+}
+
+/*
+ *  Each stage only narrows the interval of the previous ones. The upper bound
+ *  of a stage holds because every MBR of the query holds at least one point:
+ *  the nearest neighbor of a point is no farther than the farthest corner of
+ *  the closest query MBR.
+ */
+
+void SpatialIndex::RTree::RTree::hausdorffProgressive(RTree& query, double eps, double timeLimit, uint32_t maxDistCals, HausdorffBounds& b, IVisitor& v)
+{
+	HausdorffBudget budget(eps, timeLimit, maxDistCals, v);
+	uint64_t id1, id2;
+
+	b = HausdorffBounds();
+
+	if (getEmptyDistance(query, b.m_lb))
+	{
+		b.m_ub = b.m_lb;
+		return;
+	}
+
+	// the roots.
+	NodePtr root1 = readNode(m_rootID);
+	NodePtr root2 = query.readNode(query.m_rootID);
+
+	b.m_lb = hausdorff(query, id1, id2, 1, v);
+	b.m_ub = std::sqrt(root1->m_nodeMBR.getMaximumDistanceSq(root2->m_nodeMBR));
+	v.incNumDistCals(1);
+
+	if (budget.isExhausted(b.m_lb, b.m_ub, v)) return;
+
+	// the selected MBRs.
+	if (! m_vec_pMBR.empty() && ! query.m_vec_pMBR.empty())
+	{
+		b.m_lb = std::max(b.m_lb, hausdorff(query, id1, id2, 2, v));
+		b.m_ub = std::min(b.m_ub, getSummaryUpperBound(query, false, v));
+		b.m_lb = std::min(b.m_lb, b.m_ub);
+
+		if (budget.isExhausted(b.m_lb, b.m_ub, v)) return;
+	}
+
+	// down to the leaves.
+	HausdorffBounds d;
+	hausdorffDualTree(query, 0.0, &budget, d, v);
+
+	b.m_id1 = d.m_id1;
+	b.m_id2 = d.m_id2;
+
+	if (d.m_lb == d.m_ub)
+	{
+		b.m_lb = b.m_ub = d.m_ub;
+	}
+	else
+	{
+		b.m_ub = std::min(b.m_ub, d.m_ub);
+		b.m_lb = std::min(std::max(b.m_lb, d.m_lb), b.m_ub);
+	}
+}
+
+void SpatialIndex::RTree::hausdorffProgressive(
+	ISpatialIndex& tree,
+	ISpatialIndex& query,
+	double eps,
+	double timeLimit,
+	uint32_t maxDistCals,
+	HausdorffBounds& result,
+	IVisitor& v)
+{
+	RTree* t = dynamic_cast<RTree*>(&tree);
+	RTree* q = dynamic_cast<RTree*>(&query);
+	if (t == 0 || q == 0) throw Tools::IllegalArgumentException("hausdorffProgressive: both indices must be RTrees.");
+
+	t->hausdorffProgressive(*q, eps, timeLimit, maxDistCals, result, v);
+}
+
+/*
+ *  Upper bound from the selected MBRs of both trees: every point in m_vec_pMBR[i] is within
+ *  the smallest maximum distance from m_vec_pMBR[i] to a query MBR of some query point. With
+ *  bMean, the bounds are averaged with the point counts of m_vec_pMBR.
+ */
+
+double SpatialIndex::RTree::RTree::getSummaryUpperBound(RTree& query, bool bMean, IVisitor& v) const
+{
+	double ub = 0.0, sum = 0.0, count = 0.0;
+
+	for (uint32_t i = 0; i < m_vec_pMBR.size(); ++i)
+	{
+		double min = std::numeric_limits<double>::max();
+		for (uint32_t j = 0; j < query.m_vec_pMBR.size(); ++j)
+		{
+			min = std::min(min, m_vec_pMBR[i]->getMaximumDistanceSq(*(query.m_vec_pMBR[j])));
+		}
+		ub = std::max(ub, min);
+		sum += std::sqrt(min) * m_vec_pointCount[i];
+		count += m_vec_pointCount[i];
+	}
+	v.incNumDistCals(m_vec_pMBR.size() * query.m_vec_pMBR.size());
+
+	if (bMean && count > 0.0) return sum / count;
+	return std::sqrt(ub);
+}
+
+/*
+ *  Tries the bounds of modes 3, 1 and 2 in turn against threshold. Returns the mode
+ *  whose lower bound is above threshold, or whose upper bound is at most threshold,
+ *  with that bound in bound, or 0 if none of them decides.
+ */
+
+int SpatialIndex::RTree::RTree::decideByBounds(RTree& query, double threshold, bool bMean, double& bound, IVisitor& v)
+{
+	uint64_t id1, id2;
+
+	// with an empty tree the distance is known, and the cheapest stage decides.
+	if (getEmptyDistance(query, bound)) return 3;
+
+	// mode 3, and the root upper bound for mode 1.
+	NodePtr root1 = readNode(m_rootID);
+	NodePtr root2 = query.readNode(query.m_rootID);
+
+	double lb = root1->m_nodeMBR.getMinimumDistance(root2->m_nodeMBR);
+	double ub = std::sqrt(root1->m_nodeMBR.getMaximumDistanceSq(root2->m_nodeMBR));
+	v.incNumDistCals(2);
+
+	if (lb > threshold)
+	{
+		bound = lb;
+		return 3;
+	}
+
+	// mode 1.
+	if (m_pRootMBR != 0 && query.m_pRootMBR != 0)
+	{
+		lb = std::max(lb, (bMean) ? mhausdorff(query, id1, id2, 1, v) : hausdorff(query, id1, id2, 1, v));
+	}
+
+	if (lb > threshold || ub <= threshold)
+	{
+		bound = (lb > threshold) ? lb : ub;
+		return 1;
+	}
+
+	// mode 2.
+	if (! m_vec_pMBR.empty() && ! query.m_vec_pMBR.empty())
+	{
+		lb = std::max(lb, (bMean) ? mhausdorff(query, id1, id2, 2, v) : hausdorff(query, id1, id2, 2, v));
+		ub = std::min(ub, getSummaryUpperBound(query, bMean, v));
+
+		if (lb > threshold || ub <= threshold)
+		{
+			bound = (lb > threshold) ? lb : ub;
+			return 2;
+		}
+	}
+
+	return 0;
+}
+
+double SpatialIndex::RTree::RTree::hausdorffCascade(RTree& query, double threshold, int mode, bool bMean, uint64_t& id1, uint64_t& id2, IVisitor& v)
+{
+	if (mode > 0 || (bMean && mode < -2) || mode < -4)
+		throw Tools::IllegalArgumentException("hausdorffCascade: mode must select an exact distance.");
+
+	double ret;
+	int stage = decideByBounds(query, threshold, bMean, ret, v);
+
+	if (stage == 0)
+	{
+		ret = (bMean) ? mhausdorff(query, id1, id2, mode, v) : hausdorff(query, id1, id2, mode, v);
+		stage = mode;
+	}
+
+	v.setDecidingMode(stage);
+	return ret;
+}
+
+double SpatialIndex::RTree::hausdorffCascade(
+	ISpatialIndex& tree,
+	ISpatialIndex& query,
+	double threshold,
+	int mode,
+	bool bMean,
+	uint64_t& id1,
+	uint64_t& id2,
+	IVisitor& v)
+{
+	RTree* t = dynamic_cast<RTree*>(&tree);
+	RTree* q = dynamic_cast<RTree*>(&query);
+	if (t == 0 || q == 0) throw Tools::IllegalArgumentException("hausdorffCascade: both indices must be RTrees.");
+
+	return t->hausdorffCascade(*q, threshold, mode, bMean, id1, id2, v);
+}
+
+/*
+ *  Decides h(this, query) <= eps without computing the distance. After the bounds of
+ *  modes 3, 1 and 2, both trees are descended together, keeping for every entry of
+ *  this tree the query entries within eps of it. The search stops at the first entry
+ *  with no such query entry, and skips entries that are within eps of all points of
+ *  a query entry. A point of this tree left undecided is settled with a range probe
+ *  of radius eps that ends at the first query point found.
+ */
+
+bool SpatialIndex::RTree::RTree::hausdorffWithin(RTree& query, double eps, IVisitor& v)
+{
+	if (eps < 0.0) throw Tools::IllegalArgumentException("hausdorffWithin: eps must not be negative.");
+
+	if (m_stats.m_u64Data == 0) return true;
+	if (query.m_stats.m_u64Data == 0) return false;
+
+	double bound;
+	int stage = decideByBounds(query, eps, false, bound, v);
+	if (stage != 0)
+	{
+		v.setDecidingMode(stage);
+		return bound <= eps;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	Tools::SharedLock lock(&m_rwLock);
+#else
+	if (m_rwLock == false) m_rwLock = true;
+	else throw Tools::ResourceLockedException("hausdorffWithin: cannot acquire a shared lock");
+#endif
+
+	bool ret;
+
+	try
+	{
+		NodeCache cache;
+
+		NodePtr root = readNode(m_rootID);
+		NodePtr qroot = query.readNode(query.m_rootID, cache, v);
+		v.visitNode(*root);
+
+		std::vector<HausdorffEntry> candidates;
+		for (uint32_t cChild = 0; cChild < qroot->m_children; ++cChild)
+		{
+			candidates.push_back(HausdorffEntry(qroot, cChild));
+		}
+
+		ret = withinNode(root, candidates, eps, query, cache, v);
+
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+	}
+	catch (...)
+	{
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+		throw;
+	}
+
+	v.setDecidingMode(0);
+	return ret;
+}
+
+/*
+ *  Keeps the entries of in that are within eps of r in out, replacing index entries
+ *  by their children if bExpand is set. Returns true, with out incomplete, as soon as
+ *  an entry is within eps of every point of r: always the case for a data entry
+ *  within eps of a point, when bPoint is set.
+ */
+
+bool SpatialIndex::RTree::RTree::filterCandidates(const Region& r, bool bPoint, const std::vector<HausdorffEntry>& in, bool bExpand, double eps, std::vector<HausdorffEntry>& out, RTree& query, NodeCache& cache, IVisitor& v)
+{
+	for (uint32_t i = 0; i < in.size(); ++i)
+	{
+		const HausdorffEntry& e = in[i];
+		const Region& mbr = *(e.m_pNode->m_ptrMBR[e.m_child]);
+
+		double minDist = r.getMinimumDistanceSq(mbr);
+		v.incNumDistCals(1);
+		if (std::sqrt(minDist) > eps) continue;
+
+		if (bPoint && e.m_pNode->m_level == 0) return true;
+		if (std::sqrt(r.getMaximumDistanceSq(mbr)) <= eps) return true;
+
+		if (bExpand && e.m_pNode->m_level > 0)
+		{
+			NodePtr n = query.readNode(e.m_pNode->m_pIdentifier[e.m_child], cache, v);
+
+			std::vector<HausdorffEntry> children;
+			for (uint32_t cChild = 0; cChild < n->m_children; ++cChild) children.push_back(HausdorffEntry(n, cChild));
+			if (filterCandidates(r, bPoint, children, false, eps, out, query, cache, v)) return true;
+		}
+		else
+		{
+			out.push_back(e);
+			out.back().m_minDist = minDist;
+		}
+	}
+
+	return false;
+}
+
+/*
+ *  Returns false as soon as an entry of n is found with no query entry within eps.
+ *  The entries closest to being that far are examined first.
+ */
+
+bool SpatialIndex::RTree::RTree::withinNode(const NodePtr& n, const std::vector<HausdorffEntry>& candidates, double eps, RTree& query, NodeCache& cache, IVisitor& v)
+{
+	bool bPoint = (n->m_level == 0);
+	std::vector<std::vector<HausdorffEntry> > lists(n->m_children);
+	std::vector<std::pair<double, uint32_t> > order;
+
+	for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+	{
+		if (filterCandidates(*(n->m_ptrMBR[cChild]), bPoint, candidates, ! bPoint, eps, lists[cChild], query, cache, v)) continue;
+		if (lists[cChild].empty()) return false;
+
+		double closest = std::numeric_limits<double>::max();
+		for (uint32_t i = 0; i < lists[cChild].size(); ++i) closest = std::min(closest, lists[cChild][i].m_minDist);
+		order.push_back(std::make_pair(closest, cChild));
+	}
+
+	std::sort(order.begin(), order.end(), std::greater<std::pair<double, uint32_t> >());
+
+	for (uint32_t i = 0; i < order.size(); ++i)
+	{
+		uint32_t cChild = order[i].second;
+
+		if (bPoint)
+		{
+			if (! hasNeighborWithin(*(n->m_ptrMBR[cChild]), lists[cChild], eps, query, cache, v)) return false;
+		}
+		else
+		{
+			NodePtr child = readNode(n->m_pIdentifier[cChild]);
+			v.visitNode(*child);
+			if (! withinNode(child, lists[cChild], eps, query, cache, v)) return false;
+		}
+
+		std::vector<HausdorffEntry>().swap(lists[cChild]);
+	}
+
+	return true;
+}
+
+/*
+ *  Range probe of radius eps around the point p, restricted to the index entries of
+ *  the query in entries. Stops at the first query point found.
+ */
+
+bool SpatialIndex::RTree::RTree::hasNeighborWithin(const Region& p, std::vector<HausdorffEntry>& entries, double eps, RTree& query, NodeCache& cache, IVisitor& v)
+{
+	std::sort(entries.begin(), entries.end(), HausdorffEntry::ascending());
+	std::reverse(entries.begin(), entries.end());
+
+	for (uint32_t i = 0; i < entries.size(); ++i)
+	{
+		NodePtr n = query.readNode(entries[i].m_pNode->m_pIdentifier[entries[i].m_child], cache, v);
+
+		std::vector<HausdorffEntry> children;
+		for (uint32_t cChild = 0; cChild < n->m_children; ++cChild) children.push_back(HausdorffEntry(n, cChild));
+
+		std::vector<HausdorffEntry> next;
+		if (filterCandidates(p, true, children, false, eps, next, query, cache, v)) return true;
+		if (! next.empty() && hasNeighborWithin(p, next, eps, query, cache, v)) return true;
+	}
+
+	return false;
+}
+
+bool SpatialIndex::RTree::hausdorffWithin(ISpatialIndex& tree, ISpatialIndex& query, double eps, IVisitor& v)
+{
+	RTree* t = dynamic_cast<RTree*>(&tree);
+	RTree* q = dynamic_cast<RTree*>(&query);
+	if (t == 0 || q == 0) throw Tools::IllegalArgumentException("hausdorffWithin: both indices must be RTrees.");
+
+	return t->hausdorffWithin(*q, eps, v);
+}
+
+double SpatialIndex::RTree::partialHausdorff(
+	ISpatialIndex& tree,
+	ISpatialIndex& query,
+	uint32_t k,
+	uint64_t& id1,
+	uint64_t& id2,
+	IVisitor& v)
+{
+	RTree* t = dynamic_cast<RTree*>(&tree);
+	RTree* q = dynamic_cast<RTree*>(&query);
+	if (t == 0 || q == 0) throw Tools::IllegalArgumentException("partialHausdorff: both indices must be RTrees.");
+
+	return t->partialHausdorff(*q, k, id1, id2, v);
+}
+
+double SpatialIndex::RTree::quantileHausdorff(
+	ISpatialIndex& tree,
+	ISpatialIndex& query,
+	double quantile,
+	uint64_t& id1,
+	uint64_t& id2,
+	IVisitor& v)
+{
+	if (! (quantile > 0.0 && quantile <= 1.0)) throw Tools::IllegalArgumentException("quantileHausdorff: quantile must be in (0, 1].");
+
+	IStatistics* pStats;
+	tree.getStatistics(&pStats);
+	uint64_t points = pStats->getNumberOfData();
+	delete pStats;
+
+	// the ceil(quantile * points)-th smallest distance is the k-th largest.
+	uint64_t rank = static_cast<uint64_t>(std::ceil(quantile * points));
+	uint32_t k = static_cast<uint32_t>(points - std::max<uint64_t>(rank, 1) + 1);
+	if (points == 0) k = 1;
+
+	return partialHausdorff(tree, query, k, id1, id2, v);
+}
+
+void SpatialIndex::RTree::allNearestNeighborJoin(ISpatialIndex& tree, ISpatialIndex& query, IPairVisitor& pv, IVisitor& v)
+{
+	RTree* t = dynamic_cast<RTree*>(&tree);
+	RTree* q = dynamic_cast<RTree*>(&query);
+	if (t == 0 || q == 0) throw Tools::IllegalArgumentException("allNearestNeighborJoin: both indices must be RTrees.");
+
+	t->allNearestNeighborJoin(*q, pv, v);
+}
+
+void SpatialIndex::RTree::closestPairsQuery(ISpatialIndex& tree, ISpatialIndex& other, uint32_t k, IPairVisitor& pv, IVisitor& v)
+{
+	RTree* t = dynamic_cast<RTree*>(&tree);
+	if (t == 0) throw Tools::IllegalArgumentException("closestPairsQuery: the index must be an RTree.");
+
+	t->closestPairsQuery(k, other, pv, v);
+}
+
+void SpatialIndex::RTree::spatialJoinQuery(ISpatialIndex& tree, ISpatialIndex& other, double distance, IPairVisitor& pv, IVisitor& v)
+{
+	RTree* t = dynamic_cast<RTree*>(&tree);
+	if (t == 0) throw Tools::IllegalArgumentException("spatialJoinQuery: the index must be an RTree.");
+
+	t->spatialJoinQuery(other, distance, pv, v);
+}
+
+uint64_t SpatialIndex::RTree::countQuery(ISpatialIndex& tree, const IShape& query, IVisitor& v)
+{
+	RTree* t = dynamic_cast<RTree*>(&tree);
+	if (t == 0) throw Tools::IllegalArgumentException("countQuery: the index must be an RTree.");
+
+	return t->countQuery(query, v);
+}
+
+/*
+ *  Mode -2: Actual MHD, one bounded nearest neighbor search per point.
+ *  Mode -1: Actual MHD, all nearest neighbor join.
+ *  Mode 0: Actual MHD over m_pointBuffer.
+ *  Mode 1: Lower bound computed from the root MBRs.
+ *  Mode 2: Lower bound computed from the selected MBRs.
+ *  Mode 3: Just Mindist.
+ *
+ *  As in hausdorff, modes 1 and 2 fall back to the next cheaper bound when
+ *  selectMBRs has not been called on both trees.
+ */
+
+double SpatialIndex::RTree::RTree::mhausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v)
+{
+	double retDist;
+	RTree *queryRTreePtr = dynamic_cast<RTree*>(&query);
+
+	//std::cout << *queryRTreePtr << std::endl;
+
+	if (mode < -2 || mode > 3) throw Tools::IllegalArgumentException("mhausdorff: unknown mode.");
+	if (getEmptyDistance(*queryRTreePtr, retDist)) return retDist;
+
+
+	if (mode==-2) {
+		retDist = this->mhausdorffTree(*queryRTreePtr, id1, id2, v);
+	} else if (mode==-1) {
+		retDist = this->mhausdorff(query, id1, id2, v);
+	} else if (mode == 0) {
+		retDist = this->mhausdorff2(query, id1, id2, m_workerThreads, v);
+	} else if ((mode==1 || mode==2) && (m_pRootMBR == 0 || queryRTreePtr->m_pRootMBR == 0)) {
+		retDist = this->mhausdorff(query, id1, id2, 3, v);
+	} else if (mode==1 || (mode==2 && (m_vec_pMBR.empty() || queryRTreePtr->m_vec_pMBR.empty()))) {
+		//NodePtr root1 = readNode(this->m_rootID);
+		//NodePtr root2 = queryRTreePtr->readNode(queryRTreePtr->m_rootID);
+		//retDist = root1->m_nodeMBR.getMHausDistLB(root2->m_nodeMBR);
+		retDist = m_pRootMBR->getMHausDistLB(*(queryRTreePtr->m_pRootMBR));
+
+		v.incNumDistCals(1);
+	} else if (mode==2) {
+		float weighted_dist = 0.0;
+		uint32_t total_pointCount = 0;
+		for (int i=this->m_vec_pMBR.size()-1; i>=0; i--) {
+			const Region* r = this->m_vec_pMBR[i];
+			uint32_t counter = 0;
+			weighted_dist += std::sqrt(queryRTreePtr->m_packedMBRs.getMinimumDistanceSq(r->m_pLow, r->m_pHigh, 0.0, counter)) * this->m_vec_pointCount[i];
+			total_pointCount += this->m_vec_pointCount[i];
+		}
+		v.incNumDistCals(m_vec_pMBR.size()*queryRTreePtr->m_vec_pMBR.size());
+
+		if (! this->m_pointBuffer.empty() && this->m_pointBuffer.size() != total_pointCount) {
+			throw Tools::IllegalStateException("mhausdorff: the selected MBRs do not count every point.");
+		}
+
+
+		//std::cout << this->m_pointCount << std::endl;
+		retDist = weighted_dist / this->m_pointCount;
+
+	} else if (mode==3) {
+		NodePtr root1 = readNode(this->m_rootID);
+		NodePtr root2 = queryRTreePtr->readNode(queryRTreePtr->m_rootID);
+		retDist = root1->m_nodeMBR.getMinimumDistance(root2->m_nodeMBR);
+	} else {
+		throw Tools::IllegalArgumentException("mhausdorff: unknown mode.");
+	}
+
+	return retDist;
+}
+
+void SpatialIndex::RTree::RTree::updatePointCount() {
+	// with AggregateCounts this is just a read of the root.
+	NodePtr root = readNode(this->m_rootID);
+	this->m_pointCount = root->updatePointCount();
+}
+
+
+
+
+double SpatialIndex::RTree::RTree::mhausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, IVisitor& v)
+{
+	RTree* q = dynamic_cast<RTree*>(&query);
+	if (q == 0) throw Tools::IllegalArgumentException("mhausdorff: the query must be an RTree.");
+
+	NearestDistances nearest;
+	allNearestNeighborJoin(*q, nearest, v);
+
+	double ave = 0.0;
+
+	if (! nearest.m_dist.empty())
+	{
+		double sum = 0.0;
+		for (uint32_t i = 0; i < nearest.m_dist.size(); ++i) sum += nearest.m_dist[i];
+		ave = sum / nearest.m_dist.size();
+
+		uint32_t i = getMHDWitness(nearest.m_dist, ave);
+		id1 = nearest.m_id1[i];
+		id2 = nearest.m_id2[i];
+	}
+
+	v.setDistance(ave);
+	return ave;
+}
+
+
+double SpatialIndex::RTree::RTree::hausdorff2(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, uint32_t threads, IVisitor& v)
+{
+	RTree *queryRTreePtr = dynamic_cast<RTree*>(&query);
+
+	listAllPoints();
+	queryRTreePtr->listAllPoints();
+
+	PointScanTask task(PointScanTask::PS_HAUSDORFF, *this, *queryRTreePtr);
+	Tools::runParallel(task, task.getNumberOfChunks(), threads);
+	v.incNumDistCals(task.getNumDistCals());
+
+	double max = 0;
+	for (uint32_t cChunk = 0; cChunk < task.getNumberOfChunks(); ++cChunk) {
+		if (task.m_value[cChunk] > max) {
+			max = task.m_value[cChunk];
+			id1 = task.m_id1[cChunk];
+			id2 = task.m_id2[cChunk];
+		}
+	}
+	// DBL_MAX, as a distance and not squared, when the query has no points.
+	return (queryRTreePtr->m_pointBuffer.empty() && ! m_pointBuffer.empty()) ? max : std::sqrt(max);
+}
+
+/*
+ *  Outer and inner orderings of the early-break kernel.
+ */
+
+// A random permutation of [0, n). The seed is fixed so that distance counts
+// are reproducible between runs.
+static void getRandomOrder(uint32_t n, std::vector<uint32_t>& order)
+{
+	Tools::Random rnd(n, 0xD31A);
+
+	order.resize(n);
+	for (uint32_t i = 0; i < n; ++i) order[i] = i;
+
+	for (uint32_t i = n; i > 1; --i)
+	{
+		uint32_t j = rnd.nextUniformUnsignedLong(0, i);
+		std::swap(order[i - 1], order[j]);
+	}
+}
+
+// Indices of pts sorted on the Z-order (Morton) key of their coordinates,
+// quantized over the box [low, high].
+static void getZOrder(const SpatialIndex::RTree::PointBuffer& pts, const double* low, const double* high, uint32_t dimension, std::vector<uint32_t>& order)
+{
+	uint32_t bits = std::min(static_cast<uint32_t>(64 / dimension), 31u);
+	double cells = static_cast<double>((1u << bits) - 1);
+
+	std::vector<std::pair<uint64_t, uint32_t> > keys(pts.size());
+
+	for (uint32_t i = 0; i < pts.size(); ++i)
+	{
+		uint64_t key = 0;
+
+		for (uint32_t cDim = 0; cDim < dimension; ++cDim)
+		{
+			double ext = high[cDim] - low[cDim];
+			uint64_t c = (ext > 0.0) ? static_cast<uint64_t>((pts.getCoordinate(i, cDim) - low[cDim]) / ext * cells) : 0;
+
+			for (uint32_t b = 0; b < bits; ++b)
+			{
+				key |= ((c >> b) & 1) << (b * dimension + cDim);
+			}
+		}
+
+		keys[i] = std::make_pair(key, i);
+	}
+
+	std::sort(keys.begin(), keys.end());
+
+	order.resize(pts.size());
+	for (uint32_t i = 0; i < keys.size(); ++i) order[i] = keys[i].second;
+}
+
+/*
+ *  Modes -3 and -4: Actual Hausdorff distance over m_pointBuffer with early break.
+ *
+ *  The points of this tree are visited in random (mode -3) or Z-order (mode -4)
+ *  so that the running maximum grows quickly. For each of them the query points
+ *  are scanned outwards from the position of the previous point's nearest
+ *  neighbor, and the scan stops as soon as a point closer than the running
+ *  maximum is found [Taha, Hanbury 'An Efficient Algorithm for Calculating the
+ *  Exact Hausdorff Distance', PAMI 2015].
+ *
+ *  bound seeds the running maximum, as in hausdorffDualTree. The scan is abandoned
+ *  as soon as the maximum exceeds limit, and the partial maximum is returned. If pUB is given it
+ *  holds an upper bound of the squared nearest neighbor distance of every point
+ *  of this tree, and points that cannot raise the maximum are skipped. If
+ *  pQueryUB is given it receives the same bounds for the query points, taken
+ *  from the distances computed here.
+ */
+
+double SpatialIndex::RTree::RTree::hausdorffEarlyBreak(RTree& query, uint64_t& id1, uint64_t& id2, bool bZOrder, double bound, double limit, const std::vector<double>* pUB, std::vector<double>* pQueryUB, IVisitor& v)
+{
+	listAllPoints();
+	query.listAllPoints();
+
+	if (m_pointBuffer.empty() || query.m_pointBuffer.empty()) return bound;
+
+	uint32_t dim = m_pointBuffer.getDimension();
+	std::vector<uint32_t> orderA, orderB;
+
+	if (bZOrder)
+	{
+		// both sets share the same grid, so that close points get close keys.
+		std::vector<double> low(dim), high(dim);
+		m_pointBuffer.getCoordinates(0, &low[0]);
+		high = low;
+
+		for (int s = 0; s < 2; ++s)
+		{
+			const PointBuffer& pts = (s == 0) ? m_pointBuffer : query.m_pointBuffer;
+			for (uint32_t i = 0; i < pts.size(); ++i)
+			{
+				for (uint32_t cDim = 0; cDim < dim; ++cDim)
+				{
+					low[cDim] = std::min(low[cDim], pts.getCoordinate(i, cDim));
+					high[cDim] = std::max(high[cDim], pts.getCoordinate(i, cDim));
+				}
+			}
+		}
+
+		getZOrder(m_pointBuffer, &low[0], &high[0], dim, orderA);
+		getZOrder(query.m_pointBuffer, &low[0], &high[0], dim, orderB);
+	}
+	else
+	{
+		getRandomOrder(m_pointBuffer.size(), orderA);
+		getRandomOrder(query.m_pointBuffer.size(), orderB);
+	}
+
+	// copies in visiting order, so that the inner scan reads consecutive memory.
+	PointBuffer a(m_pointBuffer, orderA);
+	PointBuffer b(query.m_pointBuffer, orderB);
+
+	double max = bound * bound;
+		// squared.
+	double limitSq = (limit < std::sqrt(std::numeric_limits<double>::max())) ? limit * limit : std::numeric_limits<double>::max();
+	uint32_t start = 0;
+		// the position in b of the nearest neighbor of the previous point.
+	uint32_t cDistCals = 0;
+	uint32_t n = b.size();
+	std::vector<double> p1(dim);
+	double dist[PointBuffer::BlockSize];
+
+	if (pQueryUB != 0) pQueryUB->assign(n, std::numeric_limits<double>::max());
+
+	for (uint32_t i = 0; i < a.size(); ++i)
+	{
+		if (pUB != 0 && (*pUB)[orderA[i]] <= max) continue;
+
+		a.getCoordinates(i, &p1[0]);
+		double min = std::numeric_limits<double>::max();
+		uint32_t nnpos = start;
+
+		// alternate between blocks on both sides of the starting position;
+		// [down, up) has been scanned.
+		uint32_t up = start, down = start;
+		bool bUp = true;
+
+		while (up < n || down > 0)
+		{
+			uint32_t first, len;
+
+			if (up < n && (bUp || down == 0))
+			{
+				first = up;
+				len = std::min(PointBuffer::BlockSize, n - up);
+				up += len;
+			}
+			else
+			{
+				len = std::min(PointBuffer::BlockSize, down);
+				first = down - len;
+				down = first;
+			}
+			bUp = ! bUp;
+
+			b.getDistancesSq(&p1[0], first, len, dist);
+			cDistCals += len;
+
+			for (uint32_t k = 0; k < len; ++k)
+			{
+				if (pQueryUB != 0 && dist[k] < (*pQueryUB)[orderB[first + k]]) (*pQueryUB)[orderB[first + k]] = dist[k];
+
+				if (dist[k] < min)
+				{
+					min = dist[k];
+					nnpos = first + k;
+				}
+			}
+
+			if (min < max) break;
+		}
+
+		start = nnpos;
+
+		if (min > max)
+		{
+			max = min;
+			id1 = a.getIdentifier(i);
+			id2 = b.getIdentifier(nnpos);
+
+			if (max > limitSq) break;
+		}
+	}
+
+	v.incNumDistCals(cDistCals);
+
+	return std::sqrt(max);
+}
+
+double SpatialIndex::RTree::RTree::mhausdorff2(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, uint32_t threads, IVisitor& v)
+{
+	RTree *queryRTreePtr = dynamic_cast<RTree*>(&query);
+
+	listAllPoints();
+	queryRTreePtr->listAllPoints();
+
+	PointScanTask task(PointScanTask::PS_MEAN, *this, *queryRTreePtr);
+	Tools::runParallel(task, task.getNumberOfChunks(), threads);
+	v.incNumDistCals(task.getNumDistCals());
+
+	double sum = 0;
+	for (uint32_t cChunk = 0; cChunk < task.getNumberOfChunks(); ++cChunk) {
+		sum += task.m_value[cChunk];
+	}
+
+	double ave = sum/this->m_pointBuffer.size();
+
+	// the nearest neighbors are kept by the scan, so the witness pair costs one pass over them.
+	if (! task.m_nearest.empty())
+	{
+		uint32_t i = getMHDWitness(task.m_nearest, ave);
+		id1 = m_pointBuffer.getIdentifier(i);
+		id2 = task.m_nearestID[i];
+	}
+
+	return ave;
+}
+
+/*
+ *  The average nearest neighbor distance of m_pointBuffer in the query, without the witness pair.
+ */
+
+double SpatialIndex::RTree::RTree::getMeanNearestDistance(RTree& query, uint32_t threads, IVisitor& v)
+{
+	listAllPoints();
+	query.listAllPoints();
+
+	PointScanTask task(PointScanTask::PS_MEAN, *this, query);
+	Tools::runParallel(task, task.getNumberOfChunks(), threads);
+	v.incNumDistCals(task.getNumDistCals());
+
+	double sum = 0;
+	for (uint32_t cChunk = 0; cChunk < task.getNumberOfChunks(); ++cChunk) {
+		sum += task.m_value[cChunk];
+	}
+
+	return sum/this->m_pointBuffer.size();
+}
+
+/*
+ *  Mode -2 of mhausdorff: one nearest neighbor search in the query tree per point.
+ *
+ *  The points are taken in the order of listAllPoints, which keeps the points of
+ *  a leaf together, so the nearest neighbor of the previous point is usually
+ *  close. Its distance to the current point bounds the search, and query
+ *  entries farther than that are never opened. Nodes of the query tree are
+ *  cached for the duration of the call.
+ */
+
+double SpatialIndex::RTree::RTree::mhausdorffTree(RTree& query, uint64_t& id1, uint64_t& id2, IVisitor& v)
+{
+	listAllPoints();
+
+#ifdef HAVE_PTHREAD_H
+	Tools::SharedLock lock(&m_rwLock);
+#else
+	if (m_rwLock == false) m_rwLock = true;
+	else throw Tools::ResourceLockedException("mhausdorffTree: cannot acquire a shared lock");
+#endif
+
+	try
+	{
+		NodeCache cache;
+		uint32_t n = m_pointBuffer.size();
+		std::vector<double> nearest(n);
+		std::vector<id_type> nearestID(n);
+		std::vector<double> p(m_dimension);
+
+		NodePtr qroot = query.readNode(query.m_rootID, cache, v);
+		HausdorffEntry nn(qroot, 0);
+		bool bPrevious = false;
+		double sum = 0.0;
+
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			m_pointBuffer.getCoordinates(i, &p[0]);
+			Region r(&p[0], &p[0], m_dimension);
+
+			double boundSq = std::numeric_limits<double>::max();
+			if (bPrevious)
+			{
+				const double* q = nn.m_pNode->m_ptrMBR[nn.m_child]->m_pLow;
+				boundSq = 0.0;
+				for (uint32_t cDim = 0; cDim < m_dimension; ++cDim) boundSq += (p[cDim] - q[cDim]) * (p[cDim] - q[cDim]);
+				v.incNumDistCals(1);
+			}
+
+			bPrevious = query.nearestEntry(r, boundSq, nn, cache, v);
+			if (! bPrevious) break;
+
+			nearest[i] = std::sqrt(nn.m_minDist);
+			nearestID[i] = nn.m_pNode->m_pIdentifier[nn.m_child];
+			sum += nearest[i];
+		}
+
+		double ave = 0.0;
+
+		if (bPrevious)
+		{
+			ave = sum / n;
+
+			uint32_t i = getMHDWitness(nearest, ave);
+			id1 = m_pointBuffer.getIdentifier(i);
+			id2 = nearestID[i];
+		}
+
+		v.setDistance(ave);
+
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+
+		return ave;
+	}
+	catch (...)
+	{
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+		throw;
+	}
+}
+
+/*
+ *  All nearest neighbor join: passes every data entry of this tree to pv with its
+ *  nearest data entry in query and their distance, in the order of the leaves.
+ *  Both trees are descended together as in mode -2 of hausdorff, so the searches
+ *  of all points of a leaf start from the same short list of query entries, and
+ *  each is bounded by the distance to the neighbor of the previous point.
+ */
+
+void SpatialIndex::RTree::RTree::allNearestNeighborJoin(RTree& query, IPairVisitor& pv, IVisitor& v)
+{
+	if (query.m_dimension != m_dimension) throw Tools::IllegalArgumentException("allNearestNeighborJoin: trees have different numbers of dimensions.");
+
+#ifdef HAVE_PTHREAD_H
+	Tools::SharedLock lock(&m_rwLock);
+#else
+	if (m_rwLock == false) m_rwLock = true;
+	else throw Tools::ResourceLockedException("allNearestNeighborJoin: cannot acquire a shared lock");
+#endif
+
+	try
+	{
+		NodeCache cache;
+
+		NodePtr root = readNode(m_rootID);
+		NodePtr qroot = query.readNode(query.m_rootID, cache, v);
+		v.visitNode(*root);
+
+		std::vector<HausdorffEntry> candidates;
+		for (uint32_t cChild = 0; cChild < qroot->m_children; ++cChild)
+		{
+			candidates.push_back(HausdorffEntry(qroot, cChild));
+		}
+
+		if (! candidates.empty()) allNearestNeighborJoin(root, candidates, query, cache, pv, v);
+
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+	}
+	catch (...)
+	{
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+		throw;
+	}
+}
+
+void SpatialIndex::RTree::RTree::allNearestNeighborJoin(const NodePtr& n, const std::vector<HausdorffEntry>& candidates, RTree& query, NodeCache& cache, IPairVisitor& pv, IVisitor& v)
+{
+	if (n->m_level > 0)
+	{
+		for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+		{
+			HausdorffPair p(n, cChild);
+			refineHausdorffPair(&p, candidates, query, cache, v);
+
+			NodePtr child = readNode(n->m_pIdentifier[cChild]);
+			v.visitNode(*child);
+			allNearestNeighborJoin(child, p.m_candidates, query, cache, pv, v);
+		}
+		return;
+	}
+
+	HausdorffEntry nn(n, 0);
+	bool bPrevious = false;
+
+	for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+	{
+		const double* p = n->m_ptrMBR[cChild]->m_pLow;
+		Region r(p, p, m_dimension);
+
+		double boundSq = std::numeric_limits<double>::max();
+		if (bPrevious)
+		{
+			boundSq = r.getMinimumDistanceSq(*(nn.m_pNode->m_ptrMBR[nn.m_child]));
+			v.incNumDistCals(1);
+		}
+
+		bPrevious = query.nearestEntry(r, candidates, boundSq, nn, cache, v);
+		if (! bPrevious) continue;
+
+		pv.visitPair(n->m_pIdentifier[cChild], nn.m_pNode->m_pIdentifier[nn.m_child], std::sqrt(nn.m_minDist));
+	}
+}
+
+/*
+ *  K closest pairs query [Corral, Manolopoulos, Theodoridis, Vassilakopoulos 'Closest Pair
+ *  Queries in Spatial Databases', SIGMOD 2000]. Pairs of entries are kept in a heap on
+ *  their minimum distance and the first one is expanded on the side that is higher in its
+ *  tree, or larger, until k pairs of data entries have come out. The queued pairs cover
+ *  disjoint sets of pairs of points, so the k-th smallest MaxDist among them and the pairs
+ *  reported bounds the k-th distance, and pairs farther than it are dropped.
+ */
+
+void SpatialIndex::RTree::RTree::closestPairsQuery(uint32_t k, ISpatialIndex& other, IPairVisitor& pv, IVisitor& v)
+{
+	RTree* pOther = dynamic_cast<RTree*>(&other);
+	if (pOther == 0) throw Tools::IllegalArgumentException("closestPairsQuery: the other index must be an RTree.");
+	if (pOther->m_dimension != m_dimension) throw Tools::IllegalArgumentException("closestPairsQuery: trees have different numbers of dimensions.");
+	if (k == 0) return;
+
+#ifdef HAVE_PTHREAD_H
+	Tools::SharedLock lock(&m_rwLock);
+#else
+	if (m_rwLock == false) m_rwLock = true;
+	else throw Tools::ResourceLockedException("closestPairsQuery: cannot acquire a shared lock");
+#endif
+
+	try
+	{
+		NodeCache cache, otherCache;
+		std::priority_queue<ClosestPairEntry, std::vector<ClosestPairEntry>, ClosestPairEntry::ascending> queue;
+		std::multiset<double> claims;
+		double boundSq = std::numeric_limits<double>::max();
+		uint32_t count = 0;
+
+		NodePtr root = readNode(m_rootID, cache, v);
+		NodePtr otherRoot = pOther->readNode(pOther->m_rootID, otherCache, v);
+
+		std::vector<ClosestPairEntry> children;
+		for (uint32_t cChild = 0; cChild < root->m_children; ++cChild)
+		{
+			for (uint32_t cOther = 0; cOther < otherRoot->m_children; ++cOther)
+			{
+				children.push_back(ClosestPairEntry(HausdorffEntry(root, cChild), HausdorffEntry(otherRoot, cOther)));
+			}
+		}
+
+		while (true)
+		{
+			// queue the new pairs that may still be among the k closest.
+			for (uint32_t cIndex = 0; cIndex < children.size(); ++cIndex)
+			{
+				ClosestPairEntry& e = children[cIndex];
+				const Region& r1 = *(e.m_first.m_pNode->m_ptrMBR[e.m_first.m_child]);
+				const Region& r2 = *(e.m_second.m_pNode->m_ptrMBR[e.m_second.m_child]);
+
+				e.m_minDist = r1.getMinimumDistanceSq(r2);
+				if (e.m_minDist > boundSq) continue;
+
+				e.m_claim = claims.insert(r1.getMaximumDistanceSq(r2));
+				queue.push(e);
+			}
+			v.incNumDistCals(2 * children.size());
+			children.clear();
+
+			if (claims.size() >= k)
+			{
+				std::multiset<double>::iterator it = claims.begin();
+				std::advance(it, k - 1);
+				boundSq = std::min(boundSq, *it);
+			}
+
+			if (queue.empty()) break;
+
+			ClosestPairEntry e = queue.top(); queue.pop();
+
+			bool bFirstData = (e.m_first.m_pNode->m_level == 0);
+			bool bSecondData = (e.m_second.m_pNode->m_level == 0);
+
+			if (bFirstData && bSecondData)
+			{
+				// its claim stays, the pair is an actual result.
+				pv.visitPair(e.m_first.m_pNode->m_pIdentifier[e.m_first.m_child], e.m_second.m_pNode->m_pIdentifier[e.m_second.m_child], std::sqrt(e.m_minDist));
+				if (++count == k) break;
+				continue;
+			}
+
+			claims.erase(e.m_claim);
+
+			bool bExpandFirst;
+			if (bFirstData) bExpandFirst = false;
+			else if (bSecondData) bExpandFirst = true;
+			else if (e.m_first.m_pNode->m_level != e.m_second.m_pNode->m_level) bExpandFirst = (e.m_first.m_pNode->m_level > e.m_second.m_pNode->m_level);
+			else bExpandFirst = (e.m_first.m_pNode->m_ptrMBR[e.m_first.m_child]->getArea() >= e.m_second.m_pNode->m_ptrMBR[e.m_second.m_child]->getArea());
+
+			if (bExpandFirst)
+			{
+				NodePtr n = readNode(e.m_first.m_pNode->m_pIdentifier[e.m_first.m_child], cache, v);
+				for (uint32_t cChild = 0; cChild < n->m_children; ++cChild) children.push_back(ClosestPairEntry(HausdorffEntry(n, cChild), e.m_second));
+			}
+			else
+			{
+				NodePtr n = pOther->readNode(e.m_second.m_pNode->m_pIdentifier[e.m_second.m_child], otherCache, v);
+				for (uint32_t cChild = 0; cChild < n->m_children; ++cChild) children.push_back(ClosestPairEntry(e.m_first, HausdorffEntry(n, cChild)));
+			}
+		}
+
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+	}
+	catch (...)
+	{
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+		throw;
+	}
+}
+
+void SpatialIndex::RTree::RTree::spatialJoinQuery(ISpatialIndex& other, double distance, IPairVisitor& pv, IVisitor& v)
+{
+	RTree* pOther = dynamic_cast<RTree*>(&other);
+	if (pOther == 0) throw Tools::IllegalArgumentException("spatialJoinQuery: the other index must be an RTree.");
+	if (pOther->m_dimension != m_dimension) throw Tools::IllegalArgumentException("spatialJoinQuery: trees have different numbers of dimensions.");
+	if (distance < 0.0) throw Tools::IllegalArgumentException("spatialJoinQuery: distance must not be negative.");
+
+#ifdef HAVE_PTHREAD_H
+	Tools::SharedLock lock(&m_rwLock);
+#else
+	if (m_rwLock == false) m_rwLock = true;
+	else throw Tools::ResourceLockedException("spatialJoinQuery: cannot acquire a shared lock");
+#endif
+
+	try
+	{
+		PairBatch batch(pv);
+		JoinWorker w(0);
+
+		NodePtr n1 = w.readNode(*this, m_rootID, v);
+		NodePtr n2 = w.readNode(*pOther, pOther->m_rootID, v);
+
+		if (n1->m_children > 0 && n2->m_children > 0 && n1->m_nodeMBR.getMinimumDistanceSq(n2->m_nodeMBR) <= distance * distance)
+		{
+			// with several threads, the pairs below the roots are collected and joined in parallel.
+			uint32_t threads = getJoinThreads();
+			std::vector<JoinItem> items;
+			if (threads > 1) w.m_pPlan = &items;
+
+			spatialJoin(n1, n2, *pOther, distance * distance, batch, w, v);
+			if (! items.empty()) parallelJoin(items, threads, *pOther, distance * distance, &batch, v);
+		}
+
+		batch.flush();
+
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+	}
+	catch (...)
+	{
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+		throw;
+	}
+}
+
+uint32_t SpatialIndex::RTree::RTree::getJoinThreads() const
+{
+#ifdef HAVE_PTHREAD_H
+	return (m_workerThreads == 0) ? Tools::getNumberOfProcessors() : m_workerThreads;
+#else
+	return 1;
+#endif
+}
+
+static const uint32_t JoinItemsPerThread = 16;
+	// work items a parallel join aims for, per thread.
+
+/*
+ *  Finishes a join whose first step recorded the node pairs left to join in items.
+ *  Pairs above the leaves are split further, level by level and keeping their order,
+ *  until there are JoinItemsPerThread of them per thread. The pairs are then joined
+ *  by a JoinTask. pBatch is 0 for a self join.
+ */
+
+void SpatialIndex::RTree::RTree::parallelJoin(std::vector<JoinItem>& items, uint32_t threads, RTree& other, double distanceSq, PairBatch* pBatch, IVisitor& v)
+{
+	while (items.size() < threads * JoinItemsPerThread)
+	{
+		std::vector<JoinItem> next;
+		JoinWorker w(0);
+		w.m_pPlan = &next;
+		bool bSplit = false;
+
+		for (uint32_t cItem = 0; cItem < items.size(); ++cItem)
+		{
+			const JoinItem& item = items[cItem];
+
+			// a pair of leaves would report its results.
+			if (item.m_level == 0)
+			{
+				next.push_back(item);
+				continue;
+			}
+
+			if (pBatch == 0)
+			{
+				selfJoinQuery(item.m_id1, item.m_id2, item.m_window, w, v);
+			}
+			else
+			{
+				NodePtr n1 = w.readNode(*this, item.m_id1, v);
+				NodePtr n2 = w.readNode(other, item.m_id2, v);
+				spatialJoin(n1, n2, other, distanceSq, *pBatch, w, v);
+			}
+			bSplit = true;
+		}
+
+		items.swap(next);
+		if (! bSplit) break;
+	}
+
+	JoinTask task(*this, other, distanceSq, (pBatch == 0), items, m_bStableJoinOrder, threads, pBatch, v);
+	Tools::runParallel(task, items.size(), threads);
+	task.deliver();
+}
+
+/*
+ *  Best-first search of this tree for the data entry closest to r, skipping
+ *  entries farther than sqrt(boundSq). nn receives the entry, with its squared
+ *  distance in m_minDist. Returns false if no entry is within the bound.
+ */
+
+bool SpatialIndex::RTree::RTree::nearestEntry(const Region& r, double boundSq, HausdorffEntry& nn, NodeCache& cache, IVisitor& v)
+{
+	NodePtr n = readNode(m_rootID, cache, v);
+
+	std::vector<HausdorffEntry> entries;
+	for (uint32_t cChild = 0; cChild < n->m_children; ++cChild) entries.push_back(HausdorffEntry(n, cChild));
+
+	return nearestEntry(r, entries, boundSq, nn, cache, v);
+}
+
+// The same search, started from entries of this tree instead of the root.
+bool SpatialIndex::RTree::RTree::nearestEntry(const Region& r, const std::vector<HausdorffEntry>& entries, double boundSq, HausdorffEntry& nn, NodeCache& cache, IVisitor& v)
+{
+	std::priority_queue<HausdorffEntry, std::vector<HausdorffEntry>, HausdorffEntry::ascending> heap;
+
+	for (uint32_t cIndex = 0; cIndex < entries.size(); ++cIndex)
+	{
+		HausdorffEntry e = entries[cIndex];
+		e.m_minDist = r.getMinimumDistanceSq(*(e.m_pNode->m_ptrMBR[e.m_child]));
+		if (e.m_minDist > boundSq) continue;
+
+		// a data entry is an actual neighbor, so it tightens the bound.
+		if (e.m_pNode->m_level == 0) boundSq = e.m_minDist;
+		heap.push(e);
+	}
+	v.incNumDistCals(entries.size());
+
+	while (true)
+	{
+		while (! heap.empty() && heap.top().m_minDist > boundSq) heap.pop();
+		if (heap.empty()) return false;
+
+		HausdorffEntry e = heap.top(); heap.pop();
+
+		if (e.m_pNode->m_level == 0)
+		{
+			nn = e;
+			return true;
+		}
+
+		NodePtr n = readNode(e.m_pNode->m_pIdentifier[e.m_child], cache, v);
+
+		for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+		{
+			HausdorffEntry c(n, cChild);
+			c.m_minDist = r.getMinimumDistanceSq(*(n->m_ptrMBR[cChild]));
+			if (c.m_minDist > boundSq) continue;
+
+			if (n->m_level == 0) boundSq = c.m_minDist;
+			heap.push(c);
+		}
+		v.incNumDistCals(n->m_children);
+	}
+}
+
+//
+// PointScanTask
+//
+
+static const uint32_t PointScanChunk = 32;
+	// outer points per work item.
+
+SpatialIndex::RTree::RTree::PointScanTask::PointScanTask(Kind kind, const RTree& a, const RTree& b) :
+	m_kind(kind),
+	m_a(a),
+	m_b(b),
+	m_max(0.0)
+{
+	uint32_t chunks = getNumberOfChunks();
+
+	m_value.assign(chunks, 0.0);
+	m_id1.assign(chunks, 0);
+	m_id2.assign(chunks, 0);
+	m_distCals.assign(chunks, 0);
+
+	if (kind == PS_MEAN)
+	{
+		m_nearest.assign(a.m_pointBuffer.size(), 0.0);
+		m_nearestID.assign(a.m_pointBuffer.size(), -1);
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_rwlock_init(&m_rwLock, NULL);
+#endif
+}
+
+SpatialIndex::RTree::RTree::PointScanTask::~PointScanTask()
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_rwlock_destroy(&m_rwLock);
+#endif
+}
+
+uint32_t SpatialIndex::RTree::RTree::PointScanTask::getNumberOfChunks() const
+{
+	return (m_a.m_pointBuffer.size() + PointScanChunk - 1) / PointScanChunk;
+}
+
+int SpatialIndex::RTree::RTree::PointScanTask::getNumDistCals() const
+{
+	int ret = 0;
+	for (uint32_t cChunk = 0; cChunk < m_distCals.size(); ++cChunk) ret += m_distCals[cChunk];
+	return ret;
+}
+
+void SpatialIndex::RTree::RTree::PointScanTask::run(uint32_t index, uint32_t thread)
+{
+	uint32_t start = index * PointScanChunk;
+	uint32_t end = std::min(start + PointScanChunk, m_a.m_pointBuffer.size());
+	const PointBuffer& b = m_b.m_pointBuffer;
+
+	double value = m_value[index];
+	id_type id1 = 0, id2 = 0;
+	int distCals = 0;
+	std::vector<double> p1(m_a.m_pointBuffer.getDimension());
+
+	// points closer than the largest distance found by any chunk cannot be the answer.
+	// The shared maximum is read once per chunk and written only when this chunk beats it.
+	double shared = 0.0;
+	if (m_kind == PS_HAUSDORFF)
+	{
+#ifdef HAVE_PTHREAD_H
+		Tools::SharedLock lock(&m_rwLock);
+#endif
+		shared = m_max;
+	}
+
+	for (uint32_t i = start; i < end; ++i)
+	{
+		m_a.m_pointBuffer.getCoordinates(i, &p1[0]);
+
+		double bound = (m_kind == PS_HAUSDORFF) ? std::max(value, shared) : 0.0;
+
+		uint32_t nnpos, count;
+		double min = b.getNearestSq(&p1[0], bound, nnpos, count);
+		distCals += count;
+
+		// with no query points there is no neighbor, and the distance stays at DBL_MAX.
+		id_type nnid = (b.empty()) ? -1 : b.getIdentifier(nnpos);
+
+		if (m_kind == PS_HAUSDORFF)
+		{
+			if (min > value)
+			{
+				value = min;
+				id1 = m_a.m_pointBuffer.getIdentifier(i);
+				id2 = nnid;
+
+				if (min > shared)
+				{
+#ifdef HAVE_PTHREAD_H
+					Tools::ExclusiveLock lock(&m_rwLock);
+#endif
+					m_max = std::max(m_max, min);
+					shared = m_max;
+				}
+			}
+		}
+		else
+		{
+			m_nearest[i] = (b.empty()) ? min : std::sqrt(min);
+			m_nearestID[i] = nnid;
+			value += m_nearest[i];
+		}
+	}
+
+	m_value[index] = value;
+	m_id1[index] = id1;
+	m_id2[index] = id2;
+	m_distCals[index] = distCals;
+}
+
+//
+// JoinWorker, JoinBuffer and JoinTask
+//
+
+SpatialIndex::RTree::NodePtr SpatialIndex::RTree::RTree::JoinWorker::readNode(RTree& t, id_type page, IVisitor& v)
+{
+	if (m_pTask == 0)
+	{
+		NodePtr n = t.readNode(page);
+		v.visitNode(*n);
+		return n;
+	}
+
+	NodeCache& cache = (&t == &(m_pTask->m_t1)) ? m_cache1 : m_cache2;
+	NodeCache::iterator it = cache.find(page);
+	if (it != cache.end()) return it->second;
+
+	if (cache.size() >= CacheSize) cache.clear();
+
+	NodePtr n;
+	{
+		// the storage manager, its buffer and the statistics are shared.
+#ifdef HAVE_PTHREAD_H
+		Tools::ExclusiveLock lock(&(m_pTask->m_rwLock));
+#endif
+		n = t.readNode(page);
+	}
+
+	v.visitNode(*n);
+	cache.insert(std::pair<id_type, NodePtr>(page, n));
+	return n;
+}
+
+bool SpatialIndex::RTree::RTree::JoinWorker::plan(id_type id1, id_type id2, uint32_t level, const Region* pWindow)
+{
+	if (m_pPlan == 0) return false;
+
+	m_pPlan->push_back(JoinItem(id1, id2, level, pWindow));
+	return true;
+}
+
+SpatialIndex::RTree::RTree::JoinBuffer::~JoinBuffer()
+{
+	for (uint32_t cIndex = 0; cIndex < m_data.size(); ++cIndex) delete m_data[cIndex];
+}
+
+void SpatialIndex::RTree::RTree::JoinBuffer::visitData(std::vector<const IData*>& v)
+{
+	// the self join passes its own Data entries, which only live during the call.
+	for (uint32_t cIndex = 0; cIndex < v.size(); ++cIndex)
+	{
+		const Data* d = static_cast<const Data*>(v[cIndex]);
+		Region r(d->m_region);
+		m_data.push_back(new Data(d->m_dataLength, d->m_pData, r, d->m_id));
+	}
+}
+
+void SpatialIndex::RTree::RTree::JoinBuffer::visitPair(id_type id1, id_type id2, double distance)
+{
+	m_ids1.push_back(id1);
+	m_ids2.push_back(id2);
+	m_distances.push_back(distance);
+}
+
+void SpatialIndex::RTree::RTree::JoinBuffer::visitPairs(uint32_t count, const id_type* ids1, const id_type* ids2, const double* distances)
+{
+	m_ids1.insert(m_ids1.end(), ids1, ids1 + count);
+	m_ids2.insert(m_ids2.end(), ids2, ids2 + count);
+	m_distances.insert(m_distances.end(), distances, distances + count);
+}
+
+SpatialIndex::RTree::RTree::JoinTask::JoinTask(RTree& t1, RTree& t2, double distanceSq, bool bSelfJoin, const std::vector<JoinItem>& items, bool bStableOrder, uint32_t threads, PairBatch* pBatch, IVisitor& v) :
+	m_t1(t1),
+	m_t2(t2),
+	m_distanceSq(distanceSq),
+	m_bSelfJoin(bSelfJoin),
+	m_items(items),
+	m_bStableOrder(bStableOrder),
+	m_pBatch(pBatch),
+	m_visitor(v),
+	m_delivered(0)
+{
+	for (uint32_t cThread = 0; cThread < threads; ++cThread) m_workers.push_back(new JoinWorker(this));
+	m_buffers.assign(items.size(), 0);
+
+	// the pools are not synchronised. Without them, nodes and their MBRs are simply
+	// allocated when read and deleted when released.
+	RTree* trees[2] = {&t1, &t2};
+	uint32_t count = (&t1 == &t2) ? 1 : 2;
+
+	for (uint32_t cTree = 0; cTree < count; ++cTree)
+	{
+		m_poolCapacities.push_back(trees[cTree]->m_indexPool.getCapacity());
+		m_poolCapacities.push_back(trees[cTree]->m_leafPool.getCapacity());
+		m_poolCapacities.push_back(trees[cTree]->m_regionPool.getCapacity());
+		trees[cTree]->m_indexPool.setCapacity(0);
+		trees[cTree]->m_leafPool.setCapacity(0);
+		trees[cTree]->m_regionPool.setCapacity(0);
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_rwlock_init(&m_rwLock, NULL);
+#endif
+}
+
+SpatialIndex::RTree::RTree::JoinTask::~JoinTask()
+{
+	// the cached nodes go before the pools are restored.
+	for (uint32_t cThread = 0; cThread < m_workers.size(); ++cThread) delete m_workers[cThread];
+	for (uint32_t cItem = 0; cItem < m_buffers.size(); ++cItem) delete m_buffers[cItem];
+
+	RTree* trees[2] = {&m_t1, &m_t2};
+
+	for (uint32_t cTree = 0; cTree < m_poolCapacities.size() / 3; ++cTree)
+	{
+		trees[cTree]->m_indexPool.setCapacity(m_poolCapacities[3 * cTree]);
+		trees[cTree]->m_leafPool.setCapacity(m_poolCapacities[3 * cTree + 1]);
+		trees[cTree]->m_regionPool.setCapacity(m_poolCapacities[3 * cTree + 2]);
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_rwlock_destroy(&m_rwLock);
+#endif
+}
+
+void SpatialIndex::RTree::RTree::JoinTask::run(uint32_t index, uint32_t thread)
+{
+	const JoinItem& item = m_items[index];
+	JoinWorker& w = *(m_workers[thread]);
+	JoinBuffer* b = new JoinBuffer();
+
+	try
+	{
+		if (m_bSelfJoin)
+		{
+			m_t1.selfJoinQuery(item.m_id1, item.m_id2, item.m_window, w, *b);
+		}
+		else
+		{
+			PairBatch batch(*b);
+			NodePtr n1 = w.readNode(m_t1, item.m_id1, *b);
+			NodePtr n2 = w.readNode(m_t2, item.m_id2, *b);
+			m_t1.spatialJoin(n1, n2, m_t2, m_distanceSq, batch, w, *b);
+			batch.flush();
 		}
-		sum += min;
+	}
+	catch (...)
+	{
+		delete b;
+		throw;
 	}
 
-	double ave = sum/this->m_vec_point.size();
-	computePointPairMHD(query, id1, id2,ave);
+	{
+#ifdef HAVE_PTHREAD_H
+		Tools::ExclusiveLock lock(&m_rwLock);
+#endif
+		m_buffers[index] = b;
+		m_completed.push_back(index);
+	}
 
-	return ave;
+	// the visitors are only called by the calling thread.
+	if (thread == 0) deliver();
 }
 
-void SpatialIndex::RTree::RTree::computePointPairMHD(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, double ave)
+void SpatialIndex::RTree::RTree::JoinTask::deliver()
 {
-	RTree *queryRTreePtr = dynamic_cast<RTree*>(&query);
+	while (true)
+	{
+		JoinBuffer* b = 0;
 
-	double sum = 0;
-	double minDiff = std::numeric_limits<double>::max();
-	for (int i=0; i< m_vec_point.size(); i++) {
-		Point *p1 = &(m_vec_point.at(i));
-		double min = std::numeric_limits<double>::max();
-		int nnid = -1;
-		for (int j=0; j< queryRTreePtr->m_vec_point.size(); j++) {
-			Point *p2 = &(queryRTreePtr->m_vec_point.at(j));
-			double dist = p1->getMinimumDistance(*p2);
-			if (dist < min) {
-				min = dist;
-				nnid = queryRTreePtr->m_vec_pointID[j];
+		{
+#ifdef HAVE_PTHREAD_H
+			Tools::ExclusiveLock lock(&m_rwLock);
+#endif
+			uint32_t index;
+
+			if (m_bStableOrder)
+			{
+				if (m_delivered == m_items.size() || m_buffers[m_delivered] == 0) return;
+				index = m_delivered;
+			}
+			else
+			{
+				if (m_delivered == m_completed.size()) return;
+				index = m_completed[m_delivered];
 			}
+
+			++m_delivered;
+			std::swap(b, m_buffers[index]);
 		}
-		double diff = std::abs(ave-min);
-		if (diff < minDiff) {
-			minDiff = diff;
-			id1 = this->m_vec_pointID[i];
-			id2 = nnid;
+
+		try
+		{
+			m_visitor.incNumDistCals(b->m_distCals);
+
+			if (m_bSelfJoin)
+			{
+				for (uint32_t cIndex = 0; cIndex + 1 < b->m_data.size(); cIndex += 2)
+				{
+					std::vector<const IData*> v;
+					v.push_back(b->m_data[cIndex]);
+					v.push_back(b->m_data[cIndex + 1]);
+					m_visitor.visitData(v);
+				}
+			}
+			else
+			{
+				for (uint32_t cIndex = 0; cIndex < b->m_ids1.size(); ++cIndex)
+				{
+					m_pBatch->add(b->m_ids1[cIndex], b->m_ids2[cIndex], b->m_distances[cIndex]);
+				}
+			}
+		}
+		catch (...)
+		{
+			delete b;
+			throw;
 		}
-	}
 
-	return;
+		delete b;
+	}
 }
 
 
+/*
+ *  Builds m_pointBuffer on its first use. The exact modes that need it hold only
+ *  a shared lock, and two of them may reach this on the same tree at once, so
+ *  the list is filled under the exclusive lock. Once built, the check costs a
+ *  shared lock.
+ */
+
 void SpatialIndex::RTree::RTree::listAllPoints()
 {
-
 #ifdef HAVE_PTHREAD_H
-	Tools::SharedLock lock(&m_rwLock);
+	{
+		Tools::SharedLock lock(&m_rwLock);
+		if (! m_pointBuffer.empty() || m_stats.m_u64Data == 0) return;
+	}
+
+	Tools::ExclusiveLock lock(&m_rwLock);
+
+	// another query may have filled it while this one waited for the lock.
+	if (! m_pointBuffer.empty()) return;
 #else
+	if (! m_pointBuffer.empty() || m_stats.m_u64Data == 0) return;
+
 	if (m_rwLock == false) m_rwLock = true;
-	else throw Tools::ResourceLockedException("nearestNeighborQuery: cannot acquire a shared lock");
+	else throw Tools::ResourceLockedException("listAllPoints: cannot acquire an exclusive lock");
 #endif
 
 	try {
-		m_vec_point.clear();
-		m_vec_pointID.clear();
+		m_pointBuffer.clear(m_dimension);
+		m_vec_pointOwner.clear();
 		// COMPUTE HAUSDORFF HERE
 		std::queue<id_type> node_queue;
 
@@ -930,17 +3092,13 @@ void SpatialIndex::RTree::RTree::listAllPoints()
 			{
 				if (n->m_level == 0)
 				{
-					Point p = Point(n->m_ptrMBR[cChild]->m_pLow,2);
-
-					this->m_vec_point.push_back(p);
-					this->m_vec_pointID.push_back(n->m_pIdentifier[cChild]);
+					this->m_pointBuffer.push_back(n->m_ptrMBR[cChild]->m_pLow, n->m_pIdentifier[cChild]);
 				}
 				else {
 					node_queue.push(n->m_pIdentifier[cChild]);
 				}
 			}
 		}
-		return;
 
 #ifndef HAVE_PTHREAD_H
 m_rwLock = false;
@@ -964,13 +3122,11 @@ m_rwLock = false;
  */
 
 void SpatialIndex::RTree::RTree::selectMBRs(const int num) {
-	this->listAllPoints();
 	std::priority_queue<NNEntry*, std::vector<NNEntry*>, NNEntry::ascending> queue;
 
-
-
-
-	if (num == m_vec_pMBR.size()) return;
+	// the summary survives in the header, so reopening an index does not read any node here.
+	// The point list is built on demand by the exact modes.
+	if (num > 0 && static_cast<uint32_t>(num) == m_summaryMBRs && m_summaryCoverSelection == m_coverSelection && m_pRootMBR != 0) return;
 
 	for (int i=0; i<m_vec_pMBR.size(); i++) {
 		delete m_vec_pMBR.at(i);
@@ -979,12 +3135,16 @@ void SpatialIndex::RTree::RTree::selectMBRs(const int num) {
 
 	m_vec_pMBR.clear();
 	m_vec_pointCount.clear();
+	m_vec_pointOwner.clear();
+	m_summaryMBRs = (num > 0) ? num : 0;
+	m_summaryCoverSelection = m_coverSelection;
 
 
 
 	NodePtr root = readNode(this->m_rootID);
 	IShape *pShape;
 	root->getShape(&pShape);
+	delete m_pRootMBR;
 	m_pRootMBR = new Region(2);
 	pShape->getMBR(*m_pRootMBR);
 	delete pShape;
@@ -993,6 +3153,10 @@ void SpatialIndex::RTree::RTree::selectMBRs(const int num) {
 
 	this->m_pointCount = root->updatePointCount();
 
+	if (m_coverSelection == CS_DEADSPACE) {
+		selectMBRsDeadSpace(m_summaryMBRs, root);
+		return;
+	}
 
 	if (root->m_level == 0) {
 		IShape *pShape;
@@ -1003,6 +3167,7 @@ void SpatialIndex::RTree::RTree::selectMBRs(const int num) {
 		m_vec_pointCount.push_back(root->m_pointCount);
 		delete pShape;
 
+		m_packedMBRs.assign(m_vec_pMBR, m_dimension);
 		return;
 	} else {
 		for (int i=0; i<root->getChildrenCount(); i++) {
@@ -1053,49 +3218,391 @@ void SpatialIndex::RTree::RTree::selectMBRs(const int num) {
 				//std::cout << pMBR->m_vec_pEdge.size();
 
 
-				m_vec_pMBR.push_back(pMBR);
-				m_vec_pointCount.push_back(1);
-			}
-			*/
+				m_vec_pMBR.push_back(pMBR);
+				m_vec_pointCount.push_back(1);
+			}
+			*/
+
+			IShape *pShape;
+			n->getShape(&pShape);
+			Region *pMBR = new Region(2);
+			pShape->getMBR(*pMBR);
+			m_vec_pMBR.push_back(pMBR);
+			m_vec_pointCount.push_back(n->updatePointCount());
+			delete pShape;
+		}
+
+		if (pFirst->m_pEntry != NULL) delete pFirst->m_pEntry;
+		delete pFirst;
+	}
+
+	while (! queue.empty())
+	{
+		NNEntry* e = queue.top(); queue.pop();
+		if (e->m_pEntry != 0) {
+			NodePtr n = readNode(e->m_id);
+			IShape *pShape;
+			e->m_pEntry->getShape(&pShape);
+			Region *pMBR = new Region(2);
+			pShape->getMBR(*pMBR);
+			m_vec_pMBR.push_back(pMBR);
+			m_vec_pointCount.push_back(n->updatePointCount());
+			delete pShape;
+			delete e->m_pEntry;
+		}
+		delete e;
+	}
+
+	m_packedMBRs.assign(m_vec_pMBR, m_dimension);
+}
+
+/*
+ *  Cover selection by dead space.
+ *
+ *  The cover starts with the root and the entry whose children leave the most
+ *  of its area empty is replaced by them, until there are at least num entries
+ *  or no entry has any dead space left. Leaves are opened too, so that dense
+ *  regions end up covered by their data entries. The faces of the selected
+ *  MBRs are then close to the points, which is what the face bounds of mode 2
+ *  rely on, instead of the largest nodes being split first whatever they hold.
+ */
+
+class CoverEntry
+{
+public:
+	SpatialIndex::RTree::NodePtr m_node;
+		// null for a data entry.
+	Region m_mbr;
+	double m_deadSpace;
+
+	CoverEntry(const SpatialIndex::RTree::NodePtr& n, const Region& mbr, double deadSpace) : m_node(n), m_mbr(mbr), m_deadSpace(deadSpace) {}
+
+	struct descending : public std::binary_function<CoverEntry, CoverEntry, bool>
+	{
+		bool operator()(const CoverEntry& __x, const CoverEntry& __y) const { return __x.m_deadSpace < __y.m_deadSpace; }
+	};
+}; // CoverEntry
+
+void SpatialIndex::RTree::RTree::selectMBRsDeadSpace(uint32_t num, NodePtr& root)
+{
+	std::priority_queue<CoverEntry, std::vector<CoverEntry>, CoverEntry::descending> queue;
+
+	double area = root->m_nodeMBR.getArea();
+	for (uint32_t cChild = 0; cChild < root->m_children; ++cChild) area -= root->m_ptrMBR[cChild]->getArea();
+	queue.push(CoverEntry(root, root->m_nodeMBR, area));
+
+	while (! queue.empty() && queue.size() < num && queue.top().m_deadSpace > 0.0)
+	{
+		NodePtr n = queue.top().m_node;
+		queue.pop();
+
+		for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+		{
+			if (n->m_level == 0)
+			{
+				queue.push(CoverEntry(NodePtr(), *(n->m_ptrMBR[cChild]), -1.0));
+				continue;
+			}
+
+			NodePtr c = readNode(n->m_pIdentifier[cChild]);
+			area = c->m_nodeMBR.getArea();
+			for (uint32_t cGrandChild = 0; cGrandChild < c->m_children; ++cGrandChild) area -= c->m_ptrMBR[cGrandChild]->getArea();
+			queue.push(CoverEntry(c, c->m_nodeMBR, area));
+		}
+	}
+
+	while (! queue.empty())
+	{
+		const CoverEntry& e = queue.top();
+		m_vec_pMBR.push_back(new Region(e.m_mbr));
+		m_vec_pointCount.push_back((e.m_node.get() == 0) ? 1 : e.m_node->updatePointCount());
+		queue.pop();
+	}
+
+	m_packedMBRs.assign(m_vec_pMBR, m_dimension);
+}
+
+void SpatialIndex::RTree::RTree::clearMBRs() {
+	for (int i=0; i<m_vec_pMBR.size(); i++) {
+		delete m_vec_pMBR.at(i);
+	}
+
+
+	m_vec_pMBR.clear();
+	m_vec_pointCount.clear();
+	m_vec_pointOwner.clear();
+	m_packedMBRs.clear();
+	m_summaryMBRs = 0;
+}
+
+/*
+ *  Drops everything derived from the data, when it cannot be kept up to date.
+ *  The bounds fall back to the cheaper modes until selectMBRs is called again,
+ *  and the point list is rebuilt on demand.
+ */
+
+void SpatialIndex::RTree::RTree::invalidateSummary()
+{
+	clearMBRs();
+
+	delete m_pRootMBR;
+	m_pRootMBR = 0;
+
+	m_pointBuffer.clear(m_dimension);
+}
+
+void SpatialIndex::RTree::RTree::setRootMBR()
+{
+	NodePtr root = readNode(m_rootID);
+
+	delete m_pRootMBR;
+	m_pRootMBR = new Region(root->m_nodeMBR);
+}
+
+static bool isOnBoundary(const Region& r, const double* p)
+{
+	for (uint32_t cDim = 0; cDim < r.m_dimension; ++cDim)
+	{
+		if (p[cDim] == r.m_pLow[cDim] || p[cDim] == r.m_pHigh[cDim]) return true;
+	}
+	return false;
+}
+
+static bool containsCoordinates(const Region& r, const double* p)
+{
+	for (uint32_t cDim = 0; cDim < r.m_dimension; ++cDim)
+	{
+		if (p[cDim] < r.m_pLow[cDim] || p[cDim] > r.m_pHigh[cDim]) return false;
+	}
+	return true;
+}
+
+/*
+ *  Keeps the point list and the selectMBRs summary in step with an insertion.
+ *
+ *  The point goes to the selected MBR that needs the least area enlargement to
+ *  hold it. An MBR grown to a point still has a point on each of its faces,
+ *  so the bounds of modes 1 and 2 stay valid without a rescan.
+ */
+
+void SpatialIndex::RTree::RTree::updateSummaryOnInsert(const Region& mbr, id_type id)
+{
+	const double* p = mbr.m_pLow;
+
+	m_pointCount = static_cast<int>(m_stats.m_u64Data);
+	if (! m_pointBuffer.empty()) m_pointBuffer.push_back(p, id);
+
+	if (m_pRootMBR == 0) return;
+	setRootMBR();
+
+	if (m_vec_pMBR.empty())
+	{
+		m_vec_pointOwner.clear();
+		return;
+	}
+
+	uint32_t best = 0;
+	double bestEnlargement = std::numeric_limits<double>::max();
+
+	for (uint32_t i = 0; i < m_vec_pMBR.size(); ++i)
+	{
+		const Region* r = m_vec_pMBR[i];
+		double area = 1.0, combined = 1.0;
+
+		for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			area *= r->m_pHigh[cDim] - r->m_pLow[cDim];
+			combined *= std::max(r->m_pHigh[cDim], p[cDim]) - std::min(r->m_pLow[cDim], p[cDim]);
+		}
+
+		if (combined - area < bestEnlargement)
+		{
+			bestEnlargement = combined - area;
+			best = i;
+		}
+		if (combined == area && r->containsPoint(Point(p, m_dimension))) break;
+	}
+
+	if (! m_vec_pMBR[best]->containsPoint(Point(p, m_dimension)))
+	{
+		Region r(*(m_vec_pMBR[best]));
+		r.combinePoint(Point(p, m_dimension));
+
+		delete m_vec_pMBR[best];
+		m_vec_pMBR[best] = new Region(r);
+		m_packedMBRs.assign(m_vec_pMBR, m_dimension);
+	}
+
+	++m_vec_pointCount[best];
+	if (! m_vec_pointOwner.empty()) m_vec_pointOwner.push_back(best);
+}
+
+/*
+ *  Counts every point of the list in the first selected MBR that holds it.
+ */
+
+void SpatialIndex::RTree::RTree::assignPointOwners()
+{
+	std::vector<double> q(m_dimension);
+
+	m_vec_pointOwner.assign(m_pointBuffer.size(), 0);
+	m_vec_pointCount.assign(m_vec_pMBR.size(), 0);
+
+	for (uint32_t cIndex = 0; cIndex < m_pointBuffer.size(); ++cIndex)
+	{
+		m_pointBuffer.getCoordinates(cIndex, &q[0]);
+
+		for (uint32_t i = 0; i < m_vec_pMBR.size(); ++i)
+		{
+			if (containsCoordinates(*(m_vec_pMBR[i]), &q[0]))
+			{
+				m_vec_pointOwner[cIndex] = i;
+				++m_vec_pointCount[i];
+				break;
+			}
+		}
+	}
+}
+
+/*
+ *  Keeps the point list and the selectMBRs summary in step with a deletion.
+ *
+ *  The selected MBRs can overlap, so with a point list each point records the
+ *  MBR that counts it, assigned on the first deletion. The owner of the deleted
+ *  point loses one from its count. Every MBR that had the point on a face, and
+ *  an owner left empty, is shrunk to the points it owns in one pass over the
+ *  list, and an MBR that owns none is dropped. Without a point list only a
+ *  point held by a single MBR, strictly inside it, can be accounted for, and
+ *  otherwise the summary is dropped.
+ */
+
+void SpatialIndex::RTree::RTree::updateSummaryOnDelete(const Region& mbr, id_type id)
+{
+	const double* p = mbr.m_pLow;
+	uint32_t index;
+
+	m_pointCount = static_cast<int>(m_stats.m_u64Data);
+	bool bPoints = ! m_pointBuffer.empty();
+
+	if (m_stats.m_u64Data == 0)
+	{
+		invalidateSummary();
+		return;
+	}
+
+	if (m_pRootMBR == 0 || m_vec_pMBR.empty())
+	{
+		m_vec_pointOwner.clear();
+		if (bPoints && ! m_pointBuffer.remove(p, id, index)) invalidateSummary();
+		if (m_pRootMBR != 0) setRootMBR();
+		return;
+	}
+	setRootMBR();
+
+	std::vector<uint32_t> boundary;
+
+	if (! bPoints)
+	{
+		uint32_t holding = 0, owner = 0;
+
+		for (uint32_t i = 0; i < m_vec_pMBR.size(); ++i)
+		{
+			if (! containsCoordinates(*(m_vec_pMBR[i]), p)) continue;
+
+			++holding;
+			owner = i;
+			if (isOnBoundary(*(m_vec_pMBR[i]), p)) boundary.push_back(i);
+		}
+
+		if (holding == 0) return;
+
+		if (holding == 1 && boundary.empty())
+		{
+			if (m_vec_pointCount[owner] > 0) --m_vec_pointCount[owner];
+			return;
+		}
+
+		invalidateSummary();
+		return;
+	}
+
+	if (m_vec_pointOwner.empty()) assignPointOwners();
+
+	if (! m_pointBuffer.remove(p, id, index))
+	{
+		invalidateSummary();
+		return;
+	}
+
+	// the last point moved into the hole, and so does its owner.
+	uint32_t owner = m_vec_pointOwner[index];
+	m_vec_pointOwner[index] = m_vec_pointOwner.back();
+	m_vec_pointOwner.pop_back();
+
+	if (m_vec_pointCount[owner] > 0) --m_vec_pointCount[owner];
 
-			IShape *pShape;
-			n->getShape(&pShape);
-			Region *pMBR = new Region(2);
-			pShape->getMBR(*pMBR);
-			m_vec_pMBR.push_back(pMBR);
-			m_vec_pointCount.push_back(n->updatePointCount());
-			delete pShape;
+	for (uint32_t i = 0; i < m_vec_pMBR.size(); ++i)
+	{
+		if (i == owner && m_vec_pointCount[i] == 0) boundary.push_back(i);
+		else if (containsCoordinates(*(m_vec_pMBR[i]), p) && isOnBoundary(*(m_vec_pMBR[i]), p)) boundary.push_back(i);
+	}
+
+	if (boundary.empty()) return;
+
+	// the position of every MBR in boundary, or -1.
+	std::vector<int32_t> slot(m_vec_pMBR.size(), -1);
+	for (uint32_t cBoundary = 0; cBoundary < boundary.size(); ++cBoundary) slot[boundary[cBoundary]] = cBoundary;
+
+	std::vector<double> low(boundary.size() * m_dimension, std::numeric_limits<double>::max());
+	std::vector<double> high(boundary.size() * m_dimension, -std::numeric_limits<double>::max());
+	std::vector<double> q(m_dimension);
+
+	for (uint32_t cIndex = 0; cIndex < m_pointBuffer.size(); ++cIndex)
+	{
+		int32_t cBoundary = slot[m_vec_pointOwner[cIndex]];
+		if (cBoundary < 0) continue;
+
+		m_pointBuffer.getCoordinates(cIndex, &q[0]);
+		for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+		{
+			low[cBoundary * m_dimension + cDim] = std::min(low[cBoundary * m_dimension + cDim], q[cDim]);
+			high[cBoundary * m_dimension + cDim] = std::max(high[cBoundary * m_dimension + cDim], q[cDim]);
 		}
+	}
 
-		if (pFirst->m_pEntry != NULL) delete pFirst->m_pEntry;
-		delete pFirst;
+	// the number of MBRs dropped before each one, to renumber the owners.
+	std::vector<uint32_t> shift(m_vec_pMBR.size(), 0);
+	uint32_t erased = 0;
+
+	for (uint32_t i = 0; i < shift.size(); ++i)
+	{
+		shift[i] = erased;
+		if (slot[i] >= 0 && m_vec_pointCount[i] == 0) ++erased;
 	}
 
-	while (! queue.empty())
+	// backwards, so that erasing an MBR leaves the remaining indices valid.
+	for (uint32_t cBoundary = boundary.size(); cBoundary > 0; --cBoundary)
 	{
-		NNEntry* e = queue.top(); queue.pop();
-		if (e->m_pEntry != 0) {
-			NodePtr n = readNode(e->m_id);
-			IShape *pShape;
-			e->m_pEntry->getShape(&pShape);
-			Region *pMBR = new Region(2);
-			pShape->getMBR(*pMBR);
-			m_vec_pMBR.push_back(pMBR);
-			m_vec_pointCount.push_back(n->updatePointCount());
-			delete pShape;
-			delete e->m_pEntry;
+		uint32_t i = boundary[cBoundary - 1];
+		delete m_vec_pMBR[i];
+
+		if (m_vec_pointCount[i] == 0)
+		{
+			m_vec_pMBR.erase(m_vec_pMBR.begin() + i);
+			m_vec_pointCount.erase(m_vec_pointCount.begin() + i);
+		}
+		else
+		{
+			m_vec_pMBR[i] = new Region(&low[(cBoundary - 1) * m_dimension], &high[(cBoundary - 1) * m_dimension], m_dimension);
 		}
-		delete e;
 	}
-}
 
-void SpatialIndex::RTree::RTree::clearMBRs() {
-	for (int i=0; i<m_vec_pMBR.size(); i++) {
-		delete m_vec_pMBR.at(i);
+	if (erased > 0)
+	{
+		for (uint32_t cIndex = 0; cIndex < m_vec_pointOwner.size(); ++cIndex) m_vec_pointOwner[cIndex] -= shift[m_vec_pointOwner[cIndex]];
 	}
 
-
-	m_vec_pMBR.clear();
+	m_packedMBRs.assign(m_vec_pMBR, m_dimension);
 }
 
 
@@ -1115,7 +3622,14 @@ void SpatialIndex::RTree::RTree::selfJoinQuery(const IShape& query, IVisitor& v)
 	{
 		RegionPtr mbr = m_regionPool.acquire();
 		query.getMBR(*mbr);
-		selfJoinQuery(m_rootID, m_rootID, *mbr, v);
+
+		uint32_t threads = getJoinThreads();
+		std::vector<JoinItem> items;
+		JoinWorker w(0);
+		if (threads > 1) w.m_pPlan = &items;
+
+		selfJoinQuery(m_rootID, m_rootID, *mbr, w, v);
+		if (! items.empty()) parallelJoin(items, threads, *this, 0.0, 0, v);
 
 #ifndef HAVE_PTHREAD_H
 		m_rwLock = false;
@@ -1212,6 +3726,11 @@ void SpatialIndex::RTree::RTree::getIndexProperties(Tools::PropertySet& out) con
 	var.m_val.blVal = m_bTightMBRs;
 	out.setProperty("EnsureTightMBRs", var);
 
+	// aggregate counts
+	var.m_varType = Tools::VT_BOOL;
+	var.m_val.blVal = m_bAggregateCounts;
+	out.setProperty("AggregateCounts", var);
+
 	// index pool capacity
 	var.m_varType = Tools::VT_ULONG;
 	var.m_val.ulVal = m_indexPool.getCapacity();
@@ -1231,6 +3750,21 @@ void SpatialIndex::RTree::RTree::getIndexProperties(Tools::PropertySet& out) con
 	var.m_varType = Tools::VT_ULONG;
 	var.m_val.ulVal = m_pointPool.getCapacity();
 	out.setProperty("PointPoolCapacity", var);
+
+	// worker threads
+	var.m_varType = Tools::VT_ULONG;
+	var.m_val.ulVal = m_workerThreads;
+	out.setProperty("WorkerThreads", var);
+
+	// stable join order
+	var.m_varType = Tools::VT_BOOL;
+	var.m_val.blVal = m_bStableJoinOrder;
+	out.setProperty("StableJoinOrder", var);
+
+	// cover selection
+	var.m_varType = Tools::VT_LONG;
+	var.m_val.lVal = m_coverSelection;
+	out.setProperty("CoverSelection", var);
 }
 
 void SpatialIndex::RTree::RTree::addCommand(ICommand* pCommand, CommandType ct)
@@ -1467,6 +4001,16 @@ void SpatialIndex::RTree::RTree::initNew(Tools::PropertySet& ps)
 		m_bTightMBRs = var.m_val.blVal;
 	}
 
+	// aggregate counts
+	var = ps.getProperty("AggregateCounts");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_BOOL)
+			throw Tools::IllegalArgumentException("initNew: Property AggregateCounts must be Tools::VT_BOOL");
+
+		m_bAggregateCounts = var.m_val.blVal;
+	}
+
 	// index pool capacity
 	var = ps.getProperty("IndexPoolCapacity");
 	if (var.m_varType != Tools::VT_EMPTY)
@@ -1507,6 +4051,39 @@ void SpatialIndex::RTree::RTree::initNew(Tools::PropertySet& ps)
 		m_pointPool.setCapacity(var.m_val.ulVal);
 	}
 
+	// worker threads
+	var = ps.getProperty("WorkerThreads");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_ULONG)
+			throw Tools::IllegalArgumentException("initNew: Property WorkerThreads must be Tools::VT_ULONG");
+
+		m_workerThreads = var.m_val.ulVal;
+	}
+
+	// stable join order
+	var = ps.getProperty("StableJoinOrder");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_BOOL)
+			throw Tools::IllegalArgumentException("initNew: Property StableJoinOrder must be Tools::VT_BOOL");
+
+		m_bStableJoinOrder = var.m_val.blVal;
+	}
+
+	// cover selection
+	var = ps.getProperty("CoverSelection");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (
+			var.m_varType != Tools::VT_LONG ||
+			(var.m_val.lVal != CS_AREA &&
+			var.m_val.lVal != CS_DEADSPACE))
+			throw Tools::IllegalArgumentException("initNew: Property CoverSelection must be Tools::VT_LONG and of CoverSelection type");
+
+		m_coverSelection = static_cast<CoverSelection>(var.m_val.lVal);
+	}
+
 	m_infiniteRegion.makeInfinite(m_dimension);
 
 	m_stats.m_u32TreeHeight = 1;
@@ -1620,6 +4197,37 @@ void SpatialIndex::RTree::RTree::initOld(Tools::PropertySet& ps)
 		m_pointPool.setCapacity(var.m_val.ulVal);
 	}
 
+	// worker threads
+	var = ps.getProperty("WorkerThreads");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_ULONG) throw Tools::IllegalArgumentException("initOld: Property WorkerThreads must be Tools::VT_ULONG");
+
+		m_workerThreads = var.m_val.ulVal;
+	}
+
+	// stable join order
+	var = ps.getProperty("StableJoinOrder");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (var.m_varType != Tools::VT_BOOL) throw Tools::IllegalArgumentException("initOld: Property StableJoinOrder must be Tools::VT_BOOL");
+
+		m_bStableJoinOrder = var.m_val.blVal;
+	}
+
+	// cover selection
+	var = ps.getProperty("CoverSelection");
+	if (var.m_varType != Tools::VT_EMPTY)
+	{
+		if (
+			var.m_varType != Tools::VT_LONG ||
+			(var.m_val.lVal != CS_AREA &&
+			var.m_val.lVal != CS_DEADSPACE))
+			throw Tools::IllegalArgumentException("initOld: Property CoverSelection must be Tools::VT_LONG and of CoverSelection type");
+
+		m_coverSelection = static_cast<CoverSelection>(var.m_val.lVal);
+	}
+
 	m_infiniteRegion.makeInfinite(m_dimension);
 }
 
@@ -1639,7 +4247,10 @@ void SpatialIndex::RTree::RTree::storeHeader()
 			sizeof(uint32_t) +						// m_stats.m_nodes
 			sizeof(uint64_t) +						// m_stats.m_data
 			sizeof(uint32_t) +						// m_stats.m_treeHeight
-			m_stats.m_u32TreeHeight * sizeof(uint32_t);	// m_stats.m_nodesInLevel
+			m_stats.m_u32TreeHeight * sizeof(uint32_t) +	// m_stats.m_nodesInLevel
+			getSummarySize() +						// Hausdorff summary
+			sizeof(char) +							// m_bAggregateCounts
+			sizeof(char);							// m_summaryCoverSelection
 
 	byte* header = new byte[headerSize];
 	byte* ptr = header;
@@ -1678,6 +4289,14 @@ void SpatialIndex::RTree::RTree::storeHeader()
 		ptr += sizeof(uint32_t);
 	}
 
+	storeSummary(ptr);
+	c = (char) m_bAggregateCounts;
+	memcpy(ptr, &c, sizeof(char));
+	ptr += sizeof(char);
+	c = (char) m_summaryCoverSelection;
+	memcpy(ptr, &c, sizeof(char));
+	ptr += sizeof(char);
+
 	m_pStorageManager->storeByteArray(m_headerID, headerSize, header);
 
 	delete[] header;
@@ -1728,9 +4347,125 @@ void SpatialIndex::RTree::RTree::loadHeader()
 		m_stats.m_nodesInLevel.push_back(cNodes);
 	}
 
+	// headers written before the summary existed end here.
+	if (ptr < header + headerSize) loadSummary(ptr);
+
+	// and those written before aggregate counts existed here.
+	m_bAggregateCounts = false;
+	if (ptr < header + headerSize)
+	{
+		memcpy(&c, ptr, sizeof(char));
+		m_bAggregateCounts = (c != 0);
+		ptr += sizeof(char);
+	}
+
+	// and those written before the cover selection here.
+	m_summaryCoverSelection = CS_AREA;
+	if (ptr < header + headerSize)
+	{
+		memcpy(&c, ptr, sizeof(char));
+		m_summaryCoverSelection = static_cast<CoverSelection>(c);
+		ptr += sizeof(char);
+	}
+
 	delete[] header;
 }
 
+/*
+ *  The Hausdorff summary: m_summaryMBRs, then if it is not zero m_pointCount,
+ *  the root MBR and every selected MBR with its point count. MBRs are stored
+ *  as their low and high coordinates.
+ */
+
+uint32_t SpatialIndex::RTree::RTree::getSummarySize() const
+{
+	uint32_t ret = sizeof(uint32_t);
+	if (m_summaryMBRs == 0 || m_pRootMBR == 0) return ret;
+
+	uint32_t mbrSize = 2 * m_dimension * sizeof(double);
+
+	return ret +
+		sizeof(int) +								// m_pointCount
+		mbrSize +									// m_pRootMBR
+		sizeof(uint32_t) +							// m_vec_pMBR.size()
+		m_vec_pMBR.size() * (mbrSize + sizeof(int));	// m_vec_pMBR, m_vec_pointCount
+}
+
+void SpatialIndex::RTree::RTree::storeSummary(byte*& ptr) const
+{
+	uint32_t num = (m_pRootMBR != 0) ? m_summaryMBRs : 0;
+	memcpy(ptr, &num, sizeof(uint32_t));
+	ptr += sizeof(uint32_t);
+	if (num == 0) return;
+
+	memcpy(ptr, &m_pointCount, sizeof(int));
+	ptr += sizeof(int);
+
+	uint32_t count = m_vec_pMBR.size();
+
+	for (int64_t i = -1; i < static_cast<int64_t>(count); ++i)
+	{
+		const Region* r = (i < 0) ? m_pRootMBR : m_vec_pMBR[i];
+
+		memcpy(ptr, r->m_pLow, m_dimension * sizeof(double));
+		ptr += m_dimension * sizeof(double);
+		memcpy(ptr, r->m_pHigh, m_dimension * sizeof(double));
+		ptr += m_dimension * sizeof(double);
+
+		if (i < 0)
+		{
+			memcpy(ptr, &count, sizeof(uint32_t));
+			ptr += sizeof(uint32_t);
+		}
+		else
+		{
+			memcpy(ptr, &(m_vec_pointCount[i]), sizeof(int));
+			ptr += sizeof(int);
+		}
+	}
+}
+
+void SpatialIndex::RTree::RTree::loadSummary(byte*& ptr)
+{
+	memcpy(&m_summaryMBRs, ptr, sizeof(uint32_t));
+	ptr += sizeof(uint32_t);
+	if (m_summaryMBRs == 0) return;
+
+	memcpy(&m_pointCount, ptr, sizeof(int));
+	ptr += sizeof(int);
+
+	std::vector<double> low(m_dimension), high(m_dimension);
+	uint32_t count = 0;
+
+	for (int64_t i = -1; i < static_cast<int64_t>(count); ++i)
+	{
+		memcpy(&low[0], ptr, m_dimension * sizeof(double));
+		ptr += m_dimension * sizeof(double);
+		memcpy(&high[0], ptr, m_dimension * sizeof(double));
+		ptr += m_dimension * sizeof(double);
+
+		Region* r = new Region(&low[0], &high[0], m_dimension);
+
+		if (i < 0)
+		{
+			m_pRootMBR = r;
+			memcpy(&count, ptr, sizeof(uint32_t));
+			ptr += sizeof(uint32_t);
+		}
+		else
+		{
+			int pointCount;
+			memcpy(&pointCount, ptr, sizeof(int));
+			ptr += sizeof(int);
+
+			m_vec_pMBR.push_back(r);
+			m_vec_pointCount.push_back(pointCount);
+		}
+	}
+
+	m_packedMBRs.assign(m_vec_pMBR, m_dimension);
+}
+
 void SpatialIndex::RTree::RTree::insertData_impl(uint32_t dataLength, byte* pData, Region& mbr, id_type id)
 {
 	assert(mbr.getDimension() == m_dimension);
@@ -1992,12 +4727,185 @@ void SpatialIndex::RTree::RTree::rangeQuery(RangeQueryType type, const IShape& q
 	}
 }
 
-void SpatialIndex::RTree::RTree::selfJoinQuery(id_type id1, id_type id2, const Region& r, IVisitor& vis)
+uint64_t SpatialIndex::RTree::RTree::countQuery(const IShape& query, IVisitor& v)
+{
+	if (query.getDimension() != m_dimension) throw Tools::IllegalArgumentException("countQuery: Shape has the wrong number of dimensions.");
+
+#ifdef HAVE_PTHREAD_H
+	Tools::SharedLock lock(&m_rwLock);
+#else
+	if (m_rwLock == false) m_rwLock = true;
+	else throw Tools::ResourceLockedException("countQuery: cannot acquire a shared lock");
+#endif
+
+	try
+	{
+		uint64_t count = 0;
+		std::stack<NodePtr> st;
+		NodePtr root = readNode(m_rootID);
+
+		if (root->m_children > 0 && query.intersectsShape(root->m_nodeMBR)) st.push(root);
+
+		while (! st.empty())
+		{
+			NodePtr n = st.top(); st.pop();
+			v.visitNode(*n);
+
+			for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+			{
+				if (n->m_level == 0)
+				{
+					if (query.intersectsShape(*(n->m_ptrMBR[cChild]))) ++count;
+				}
+				else if (m_bAggregateCounts && query.containsShape(*(n->m_ptrMBR[cChild])))
+				{
+					// everything below a contained entry intersects the query.
+					count += n->getEntryCount(cChild);
+				}
+				else if (query.intersectsShape(*(n->m_ptrMBR[cChild])))
+				{
+					st.push(readNode(n->m_pIdentifier[cChild]));
+				}
+			}
+		}
+
+		m_stats.m_u64QueryResults += count;
+
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+
+		return count;
+	}
+	catch (...)
+	{
+#ifndef HAVE_PTHREAD_H
+		m_rwLock = false;
+#endif
+		throw;
+	}
+}
+
+/*
+ *  Joins the entries below n1 with those below n2. The higher node is opened first, so
+ *  both sides are always at the same level when children are matched. The children
+ *  that can reach the other node are sorted on their low side along the axis where the
+ *  nodes overlap the most, and swept [Brinkhoff, Kriegel, Seeger 'Efficient Processing
+ *  of Spatial Joins Using R-trees', SIGMOD 1993]: each child is only tested against the
+ *  children of the other node that start before its high side plus the distance.
+ */
+
+void SpatialIndex::RTree::RTree::spatialJoin(const NodePtr& n1, const NodePtr& n2, RTree& other, double distanceSq, PairBatch& batch, JoinWorker& w, IVisitor& v)
+{
+	if (n1->m_level != n2->m_level)
+	{
+		bool bFirst = (n1->m_level > n2->m_level);
+		const NodePtr& n = (bFirst) ? n1 : n2;
+		const Region& r = (bFirst) ? n2->m_nodeMBR : n1->m_nodeMBR;
+
+		for (uint32_t cChild = 0; cChild < n->m_children; ++cChild)
+		{
+			if (n->m_ptrMBR[cChild]->getMinimumDistanceSq(r) > distanceSq) continue;
+
+			if (bFirst)
+			{
+				if (w.plan(n->m_pIdentifier[cChild], n2->m_identifier, n->m_level - 1, 0)) continue;
+
+				NodePtr c = w.readNode(*this, n->m_pIdentifier[cChild], v);
+				spatialJoin(c, n2, other, distanceSq, batch, w, v);
+			}
+			else
+			{
+				if (w.plan(n1->m_identifier, n->m_pIdentifier[cChild], n->m_level - 1, 0)) continue;
+
+				NodePtr c = w.readNode(other, n->m_pIdentifier[cChild], v);
+				spatialJoin(n1, c, other, distanceSq, batch, w, v);
+			}
+		}
+		v.incNumDistCals(n->m_children);
+		return;
+	}
+
+	double distance = std::sqrt(distanceSq);
+
+	uint32_t axis = 0;
+	double maxOverlap = -std::numeric_limits<double>::max();
+	for (uint32_t cDim = 0; cDim < m_dimension; ++cDim)
+	{
+		double overlap =
+			std::min(n1->m_nodeMBR.m_pHigh[cDim], n2->m_nodeMBR.m_pHigh[cDim]) -
+			std::max(n1->m_nodeMBR.m_pLow[cDim], n2->m_nodeMBR.m_pLow[cDim]);
+		if (overlap > maxOverlap)
+		{
+			maxOverlap = overlap;
+			axis = cDim;
+		}
+	}
+
+	std::vector<std::pair<double, uint32_t> > s1, s2;
+
+	for (uint32_t cChild = 0; cChild < n1->m_children; ++cChild)
+	{
+		if (n1->m_ptrMBR[cChild]->getMinimumDistanceSq(n2->m_nodeMBR) <= distanceSq) s1.push_back(std::make_pair(n1->m_ptrMBR[cChild]->m_pLow[axis], cChild));
+	}
+	for (uint32_t cChild = 0; cChild < n2->m_children; ++cChild)
+	{
+		if (n2->m_ptrMBR[cChild]->getMinimumDistanceSq(n1->m_nodeMBR) <= distanceSq) s2.push_back(std::make_pair(n2->m_ptrMBR[cChild]->m_pLow[axis], cChild));
+	}
+	v.incNumDistCals(n1->m_children + n2->m_children);
+
+	std::sort(s1.begin(), s1.end());
+	std::sort(s2.begin(), s2.end());
+
+	uint32_t i = 0, j = 0;
+
+	while (i < s1.size() && j < s2.size())
+	{
+		if (s1[i].first <= s2[j].first)
+		{
+			double high = n1->m_ptrMBR[s1[i].second]->m_pHigh[axis] + distance;
+			for (uint32_t k = j; k < s2.size() && s2[k].first <= high; ++k)
+			{
+				joinEntries(n1, s1[i].second, n2, s2[k].second, other, distanceSq, batch, w, v);
+			}
+			++i;
+		}
+		else
+		{
+			double high = n2->m_ptrMBR[s2[j].second]->m_pHigh[axis] + distance;
+			for (uint32_t k = i; k < s1.size() && s1[k].first <= high; ++k)
+			{
+				joinEntries(n1, s1[k].second, n2, s2[j].second, other, distanceSq, batch, w, v);
+			}
+			++j;
+		}
+	}
+}
+
+void SpatialIndex::RTree::RTree::joinEntries(const NodePtr& n1, uint32_t child1, const NodePtr& n2, uint32_t child2, RTree& other, double distanceSq, PairBatch& batch, JoinWorker& w, IVisitor& v)
+{
+	double d = n1->m_ptrMBR[child1]->getMinimumDistanceSq(*(n2->m_ptrMBR[child2]));
+	v.incNumDistCals(1);
+	if (d > distanceSq) return;
+
+	if (n1->m_level == 0)
+	{
+		batch.add(n1->m_pIdentifier[child1], n2->m_pIdentifier[child2], std::sqrt(d));
+		return;
+	}
+
+	if (w.plan(n1->m_pIdentifier[child1], n2->m_pIdentifier[child2], n1->m_level - 1, 0)) return;
+
+	NodePtr c1 = w.readNode(*this, n1->m_pIdentifier[child1], v);
+	NodePtr c2 = w.readNode(other, n2->m_pIdentifier[child2], v);
+
+	spatialJoin(c1, c2, other, distanceSq, batch, w, v);
+}
+
+void SpatialIndex::RTree::RTree::selfJoinQuery(id_type id1, id_type id2, const Region& r, JoinWorker& w, IVisitor& vis)
 {
-	NodePtr n1 = readNode(id1);
-	NodePtr n2 = readNode(id2);
-	vis.visitNode(*n1);
-	vis.visitNode(*n2);
+	NodePtr n1 = w.readNode(*this, id1, vis);
+	NodePtr n2 = w.readNode(*this, id2, vis);
 
 	for (uint32_t cChild1 = 0; cChild1 < n1->m_children; ++cChild1)
 	{
@@ -2026,7 +4934,10 @@ void SpatialIndex::RTree::RTree::selfJoinQuery(id_type id1, id_type id2, const R
 					else
 					{
 						Region rr = r.getIntersectingRegion(n1->m_ptrMBR[cChild1]->getIntersectingRegion(*(n2->m_ptrMBR[cChild2])));
-						selfJoinQuery(n1->m_pIdentifier[cChild1], n2->m_pIdentifier[cChild2], rr, vis);
+						if (! w.plan(n1->m_pIdentifier[cChild1], n2->m_pIdentifier[cChild2], n1->m_level - 1, &rr))
+						{
+							selfJoinQuery(n1->m_pIdentifier[cChild1], n2->m_pIdentifier[cChild2], rr, w, vis);
+						}
 					}
 				}
 			}
@@ -2040,7 +4951,9 @@ std::ostream& SpatialIndex::RTree::operator<<(std::ostream& os, const RTree& t)
 			<< "Fill factor: " << t.m_fillFactor << std::endl
 			<< "Index capacity: " << t.m_indexCapacity << std::endl
 			<< "Leaf capacity: " << t.m_leafCapacity << std::endl
-			<< "Tight MBRs: " << ((t.m_bTightMBRs) ? "enabled" : "disabled") << std::endl;
+			<< "Tight MBRs: " << ((t.m_bTightMBRs) ? "enabled" : "disabled") << std::endl
+			<< "Aggregate counts: " << ((t.m_bAggregateCounts) ? "enabled" : "disabled") << std::endl
+			<< "Cover selection: " << ((t.m_coverSelection == CS_DEADSPACE) ? "dead space" : "area") << std::endl;
 
 	if (t.m_treeVariant == RV_RSTAR)
 	{
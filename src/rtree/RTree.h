@@ -24,6 +24,8 @@
 #include "Statistics.h"
 #include "Node.h"
 #include "PointerPoolNode.h"
+#include "PointBuffer.h"
+#include "MBRBuffer.h"
 
 namespace SpatialIndex
 {
@@ -53,6 +55,18 @@ namespace SpatialIndex
 				// LeafPoolCapacity         VT_LONG   Default is 100
 				// RegionPoolCapacity       VT_LONG   Default is 1000
 				// PointPoolCapacity        VT_LONG   Default is 500
+				// WorkerThreads            VT_ULONG  Threads used by the in-memory Hausdorff kernels and by the
+				//                          spatial and self joins. 0 means one per processor. Default is 1.
+				// StableJoinOrder          VT_BOOL   Parallel joins report their results in the order of a serial
+				//                          join. Otherwise the results of a part of the join are reported as
+				//                          soon as it completes. Default is true.
+				// AggregateCounts          VT_BOOL   Index entries store the number of data entries in their subtree
+				//                          (aggregate R-tree). Only used when a new index is created.
+				//                          Default is false.
+				// CoverSelection           VT_LONG   How selectMBRs picks its MBRs, one of CS_AREA (the largest
+				//                          nodes are opened first) or CS_DEADSPACE (the nodes whose children
+				//                          leave most of their area empty are opened first, down to single
+				//                          data entries). Default is CS_AREA.
 
 			virtual ~RTree();
 
@@ -71,6 +85,14 @@ namespace SpatialIndex
 
 			virtual double hausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v);
 			virtual double mhausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v);
+			virtual double symmetricHausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v);
+			void hausdorffProgressive(RTree& query, double eps, double timeLimit, uint32_t maxDistCals, HausdorffBounds& b, IVisitor& v);
+			double hausdorffCascade(RTree& query, double threshold, int mode, bool bMean, uint64_t& id1, uint64_t& id2, IVisitor& v);
+			bool hausdorffWithin(RTree& query, double eps, IVisitor& v);
+			double partialHausdorff(RTree& query, uint32_t k, uint64_t& id1, uint64_t& id2, IVisitor& v);
+			void allNearestNeighborJoin(RTree& query, IPairVisitor& pv, IVisitor& v);
+			void closestPairsQuery(uint32_t k, ISpatialIndex& other, IPairVisitor& pv, IVisitor& v);
+			void spatialJoinQuery(ISpatialIndex& other, double distance, IPairVisitor& pv, IVisitor& v);
 
 			virtual void selfJoinQuery(const IShape& s, IVisitor& v);
 			virtual void queryStrategy(IQueryStrategy& qs);
@@ -87,6 +109,8 @@ namespace SpatialIndex
 
 			virtual void updatePointCount();
 
+			uint64_t countQuery(const IShape& query, IVisitor& v);
+
 			int m_pointCount;
 
 		private:
@@ -94,12 +118,14 @@ namespace SpatialIndex
 			void initOld(Tools::PropertySet& ps);
 			void storeHeader();
 			void loadHeader();
+			uint32_t getSummarySize() const;
+			void storeSummary(byte*& ptr) const;
+			void loadSummary(byte*& ptr);
 
 			void insertData_impl(uint32_t dataLength, byte* pData, Region& mbr, id_type id);
 			void insertData_impl(uint32_t dataLength, byte* pData, Region& mbr, id_type id, uint32_t level, byte* overflowTable);
 			bool deleteData_impl(const Region& mbr, id_type id);
 
-			void computePointPairMHD(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, double average);
 
 
 			id_type writeNode(Node*);
@@ -107,11 +133,50 @@ namespace SpatialIndex
 			void deleteNode(Node*);
 
 			void rangeQuery(RangeQueryType type, const IShape& query, IVisitor& v);
-			void selfJoinQuery(id_type id1, id_type id2, const Region& r, IVisitor& vis);
 			void listAllPoints();
-
-			double hausdorff2(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, IVisitor& v);
-			double mhausdorff2(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, IVisitor& v);
+			void invalidateSummary();
+			void updateSummaryOnInsert(const Region& mbr, id_type id);
+			void updateSummaryOnDelete(const Region& mbr, id_type id);
+			void assignPointOwners();
+			void setRootMBR();
+			void selectMBRsDeadSpace(uint32_t num, NodePtr& root);
+			double getSummaryUpperBound(RTree& query, bool bMean, IVisitor& v) const;
+			int decideByBounds(RTree& query, double threshold, bool bMean, double& bound, IVisitor& v);
+
+			double hausdorff2(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, uint32_t threads, IVisitor& v);
+			double mhausdorff2(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, uint32_t threads, IVisitor& v);
+			double getMeanNearestDistance(RTree& query, uint32_t threads, IVisitor& v);
+			double hausdorffEarlyBreak(RTree& query, uint64_t& id1, uint64_t& id2, bool bZOrder, double bound, double limit, const std::vector<double>* pUB, std::vector<double>* pQueryUB, IVisitor& v);
+
+			class HausdorffEntry;
+			class HausdorffPair;
+			class HausdorffBudget;
+			class PairBatch;
+			class JoinItem;
+			class JoinWorker;
+			class JoinTask;
+			typedef std::map<id_type, NodePtr> NodeCache;
+
+			void spatialJoin(const NodePtr& n1, const NodePtr& n2, RTree& other, double distanceSq, PairBatch& batch, JoinWorker& w, IVisitor& v);
+			void joinEntries(const NodePtr& n1, uint32_t child1, const NodePtr& n2, uint32_t child2, RTree& other, double distanceSq, PairBatch& batch, JoinWorker& w, IVisitor& v);
+			void selfJoinQuery(id_type id1, id_type id2, const Region& r, JoinWorker& w, IVisitor& vis);
+			uint32_t getJoinThreads() const;
+			void parallelJoin(std::vector<JoinItem>& items, uint32_t threads, RTree& other, double distanceSq, PairBatch* pBatch, IVisitor& v);
+
+			bool getEmptyDistance(const RTree& query, double& dist) const;
+			double hausdorffDualTree(RTree& query, uint64_t& id1, uint64_t& id2, double bound, IVisitor& v);
+			void hausdorffDualTree(RTree& query, double bound, const HausdorffBudget* pBudget, HausdorffBounds& b, IVisitor& v);
+			void refineHausdorffPair(HausdorffPair* p, const std::vector<HausdorffEntry>& candidates, RTree& query, NodeCache& cache, IVisitor& v);
+			template <class TRegion> double getCandidateBoundsSq(const TRegion& a, bool bPoint, std::vector<HausdorffEntry>& candidates, const RTree& query) const;
+			bool nearestCandidate(HausdorffPair* p, double bound, double& dist, id_type& nnid, RTree& query, NodeCache& cache, IVisitor& v);
+			bool nearestEntry(const Region& r, double boundSq, HausdorffEntry& nn, NodeCache& cache, IVisitor& v);
+			bool nearestEntry(const Region& r, const std::vector<HausdorffEntry>& entries, double boundSq, HausdorffEntry& nn, NodeCache& cache, IVisitor& v);
+			void allNearestNeighborJoin(const NodePtr& n, const std::vector<HausdorffEntry>& candidates, RTree& query, NodeCache& cache, IPairVisitor& pv, IVisitor& v);
+			double mhausdorffTree(RTree& query, uint64_t& id1, uint64_t& id2, IVisitor& v);
+			bool withinNode(const NodePtr& n, const std::vector<HausdorffEntry>& candidates, double eps, RTree& query, NodeCache& cache, IVisitor& v);
+			bool filterCandidates(const Region& r, bool bPoint, const std::vector<HausdorffEntry>& in, bool bExpand, double eps, std::vector<HausdorffEntry>& out, RTree& query, NodeCache& cache, IVisitor& v);
+			bool hasNeighborWithin(const Region& p, std::vector<HausdorffEntry>& entries, double eps, RTree& query, NodeCache& cache, IVisitor& v);
+			NodePtr readNode(id_type page, NodeCache& cache, IVisitor& v);
 
 			IStorageManager* m_pStorageManager;
 
@@ -148,6 +213,12 @@ namespace SpatialIndex
 
 			bool m_bTightMBRs;
 
+			bool m_bAggregateCounts;
+
+			uint32_t m_workerThreads;
+
+			bool m_bStableJoinOrder;
+
 			Tools::PointerPool<Point> m_pointPool;
 			Tools::PointerPool<Region> m_regionPool;
 			Tools::PointerPool<Node> m_indexPool;
@@ -159,10 +230,21 @@ namespace SpatialIndex
 
 			std::vector<const Region*> m_vec_pMBR;
 			std::vector<int> m_vec_pointCount;
-			std::vector<Point>  m_vec_point;
-			std::vector<int>  m_vec_pointID;
+			MBRBuffer m_packedMBRs;
+				// a copy of m_vec_pMBR laid out for the bound kernels of mode 2.
+			PointBuffer m_pointBuffer;
+				// the data points, filled by listAllPoints.
+			std::vector<uint32_t> m_vec_pointOwner;
+				// for each point of m_pointBuffer, the selected MBR that counts it. Empty until
+				// the first deletion that needs it.
 
 			Region* m_pRootMBR;
+			uint32_t m_summaryMBRs;
+				// the num argument of the selectMBRs call that built m_pRootMBR, m_vec_pMBR and
+				// m_vec_pointCount, or 0 if they are not current. Stored in the header with them.
+			CoverSelection m_coverSelection;
+			CoverSelection m_summaryCoverSelection;
+				// the strategy used by selectMBRs, and the one that built the current summary.
 
 #ifdef HAVE_PTHREAD_H
 			pthread_rwlock_t m_rwLock;
@@ -189,6 +271,28 @@ namespace SpatialIndex
 				};
 			}; // NNEntry
 
+			class NNQueueEntry
+			{
+				// An entry of the nearest neighbor queue. A data entry refers to its leaf,
+				// kept by the query, instead of holding a copy of the data.
+			public:
+				id_type m_id;
+				uint32_t m_leaf;
+					// index of the leaf among those kept by the query, or NoLeaf for a node.
+				uint32_t m_child;
+				double m_minDist;
+
+				NNQueueEntry(id_type id, uint32_t leaf, uint32_t child, double f) : m_id(id), m_leaf(leaf), m_child(child), m_minDist(f) {}
+				~NNQueueEntry() {}
+
+				static const uint32_t NoLeaf = 0xffffffff;
+
+				struct ascending : public std::binary_function<NNQueueEntry, NNQueueEntry, bool>
+				{
+					bool operator()(const NNQueueEntry& __x, const NNQueueEntry& __y) const { return __x.m_minDist > __y.m_minDist; }
+				};
+			}; // NNQueueEntry
+
 			class NNComparator : public INearestNeighborComparator
 			{
 			public:
@@ -207,6 +311,252 @@ namespace SpatialIndex
 				}
 			}; // NNComparator
 
+			class HausdorffEntry
+			{
+			public:
+				NodePtr m_pNode;
+				uint32_t m_child;
+				double m_minDist;
+
+				HausdorffEntry(const NodePtr& n, uint32_t child) : m_pNode(n), m_child(child), m_minDist(0.0) {}
+				~HausdorffEntry() {}
+
+				struct ascending : public std::binary_function<HausdorffEntry, HausdorffEntry, bool>
+				{
+					bool operator()(const HausdorffEntry& __x, const HausdorffEntry& __y) const { return __x.m_minDist > __y.m_minDist; }
+				};
+			}; // HausdorffEntry
+
+			class HausdorffPair
+			{
+			public:
+				HausdorffEntry m_entry;
+					// An entry of the object tree.
+				std::vector<HausdorffEntry> m_candidates;
+					// Entries of the query tree that may hold the nearest neighbor of a point below m_entry.
+				double m_lb;
+				double m_ub;
+
+				HausdorffPair(const NodePtr& n, uint32_t child) : m_entry(n, child), m_lb(0.0), m_ub(0.0) {}
+				~HausdorffPair() {}
+
+				struct descending : public std::binary_function<HausdorffPair*, HausdorffPair*, bool>
+				{
+					bool operator()(const HausdorffPair* __x, const HausdorffPair* __y) const { return __x->m_ub < __y->m_ub; }
+				};
+			}; // HausdorffPair
+
+			class ClosestPairEntry
+			{
+			public:
+				HausdorffEntry m_first;
+					// An entry of this tree.
+				HausdorffEntry m_second;
+					// An entry of the other tree.
+				double m_minDist;
+				std::multiset<double>::iterator m_claim;
+					// The MaxDist of the pair, kept while it stands for at least one pair of points.
+
+				ClosestPairEntry(const HausdorffEntry& first, const HausdorffEntry& second) : m_first(first), m_second(second), m_minDist(0.0) {}
+				~ClosestPairEntry() {}
+
+				struct ascending : public std::binary_function<ClosestPairEntry, ClosestPairEntry, bool>
+				{
+					bool operator()(const ClosestPairEntry& __x, const ClosestPairEntry& __y) const { return __x.m_minDist > __y.m_minDist; }
+				};
+			}; // ClosestPairEntry
+
+			class PairBatch
+			{
+				// Results of a join, passed to the visitor BatchSize at a time.
+			public:
+				PairBatch(IPairVisitor& pv) : m_pv(pv) {}
+				~PairBatch() {}
+
+				void add(id_type id1, id_type id2, double distance)
+				{
+					m_ids1.push_back(id1);
+					m_ids2.push_back(id2);
+					m_distances.push_back(distance);
+					if (m_ids1.size() == BatchSize) flush();
+				}
+
+				void flush()
+				{
+					if (m_ids1.empty()) return;
+					m_pv.visitPairs(m_ids1.size(), &m_ids1[0], &m_ids2[0], &m_distances[0]);
+					m_ids1.clear();
+					m_ids2.clear();
+					m_distances.clear();
+				}
+
+				static const uint32_t BatchSize = 1024;
+
+				IPairVisitor& m_pv;
+				std::vector<id_type> m_ids1;
+				std::vector<id_type> m_ids2;
+				std::vector<double> m_distances;
+			}; // PairBatch
+
+			class JoinItem
+			{
+				// A pair of nodes whose join is one work item of a parallel join.
+			public:
+				JoinItem(id_type id1, id_type id2, uint32_t level, const Region* pWindow) :
+					m_id1(id1), m_id2(id2), m_level(level)
+				{
+					if (pWindow != 0) m_window = *pWindow;
+				}
+				~JoinItem() {}
+
+				id_type m_id1;
+				id_type m_id2;
+				uint32_t m_level;
+					// the higher level of the two nodes.
+				Region m_window;
+					// the part of the query region left below the pair (self join).
+			}; // JoinItem
+
+			class JoinWorker
+			{
+				// Reads the nodes of a join. Without a task, nodes are read through the trees
+				// and reported to the visitor, as in a serial join. The workers of a parallel
+				// join keep the nodes they read in their own caches and take the task lock
+				// around each read. While m_pPlan is set, the pairs that would be joined next
+				// are appended to it instead.
+			public:
+				JoinWorker(JoinTask* pTask) : m_pTask(pTask), m_pPlan(0) {}
+				~JoinWorker() {}
+
+				NodePtr readNode(RTree& t, id_type page, IVisitor& v);
+				bool plan(id_type id1, id_type id2, uint32_t level, const Region* pWindow);
+
+				static const uint32_t CacheSize = 4096;
+					// nodes kept per tree before the cache is emptied.
+
+				JoinTask* m_pTask;
+				std::vector<JoinItem>* m_pPlan;
+				NodeCache m_cache1;
+				NodeCache m_cache2;
+			}; // JoinWorker
+
+			class JoinBuffer : public IVisitor, public IPairVisitor
+			{
+				// The results and distance computations of one work item of a parallel join.
+			public:
+				JoinBuffer() : m_distCals(0) {}
+				~JoinBuffer();
+
+				void visitNode(const INode& n) {}
+				void visitData(const IData& d) {}
+				void visitData(std::vector<const IData*>& v);
+				void incNumDistCals(int inc) { m_distCals += inc; }
+				int getNumDistCals() { return m_distCals; }
+				double getDistance() { return 0.0; }
+				void setDistance(double d) {}
+
+				void visitPair(id_type id1, id_type id2, double distance);
+				void visitPairs(uint32_t count, const id_type* ids1, const id_type* ids2, const double* distances);
+
+				std::vector<id_type> m_ids1;
+				std::vector<id_type> m_ids2;
+				std::vector<double> m_distances;
+				std::vector<Data*> m_data;
+					// self join: the two entries of each result, one after the other.
+				int m_distCals;
+			}; // JoinBuffer
+
+			class JoinTask : public Tools::IParallelTask
+			{
+				// Joins the pairs of m_items on several threads. The node pools of both trees
+				// are emptied and disabled meanwhile, so that nodes can be released by any
+				// thread. Results are buffered per item and handed to the visitors on the
+				// calling thread (worker 0), in item order if m_bStableOrder is set and in
+				// completion order otherwise.
+			public:
+				JoinTask(RTree& t1, RTree& t2, double distanceSq, bool bSelfJoin, const std::vector<JoinItem>& items, bool bStableOrder, uint32_t threads, PairBatch* pBatch, IVisitor& v);
+				virtual ~JoinTask();
+
+				virtual void run(uint32_t index, uint32_t thread);
+				void deliver();
+
+				RTree& m_t1;
+				RTree& m_t2;
+				double m_distanceSq;
+				bool m_bSelfJoin;
+				const std::vector<JoinItem>& m_items;
+				bool m_bStableOrder;
+				PairBatch* m_pBatch;
+				IVisitor& m_visitor;
+
+				std::vector<JoinWorker*> m_workers;
+					// per thread.
+				std::vector<JoinBuffer*> m_buffers;
+					// per item, set when the item completes and reset when it is delivered.
+				std::vector<uint32_t> m_completed;
+				uint32_t m_delivered;
+					// items delivered so far; an index in m_items or m_completed.
+				std::vector<uint32_t> m_poolCapacities;
+
+#ifdef HAVE_PTHREAD_H
+				pthread_rwlock_t m_rwLock;
+#endif
+			}; // JoinTask
+
+			class HausdorffBudget
+			{
+				// When to stop refining a progressive Hausdorff interval.
+			public:
+				HausdorffBudget(double eps, double timeLimit, uint32_t maxDistCals, IVisitor& v);
+
+				bool isExhausted(double lb, double ub, IVisitor& v) const;
+
+				double m_eps;
+				double m_deadline;
+					// in Tools::getCurrentTime units, or 0 for no limit.
+				uint32_t m_maxDistCals;
+				int m_startDistCals;
+			}; // HausdorffBudget
+
+			class PointScanTask : public Tools::IParallelTask
+			{
+				// Splits the outer loop of the m_pointBuffer kernels in chunks of
+				// consecutive points. Results are kept per chunk and merged in
+				// chunk order, so they do not depend on the number of threads.
+			public:
+				enum Kind
+				{
+					PS_HAUSDORFF = 0x0,
+					PS_MEAN
+				};
+
+				PointScanTask(Kind kind, const RTree& a, const RTree& b);
+				virtual ~PointScanTask();
+
+				virtual void run(uint32_t index, uint32_t thread);
+				uint32_t getNumberOfChunks() const;
+				int getNumDistCals() const;
+
+				Kind m_kind;
+				const RTree& m_a;
+				const RTree& m_b;
+				double m_max;
+					// running maximum shared by all chunks (PS_HAUSDORFF), squared.
+
+				std::vector<double> m_value;
+					// per chunk: squared maximum or sum.
+				std::vector<id_type> m_id1;
+				std::vector<id_type> m_id2;
+				std::vector<double> m_nearest;
+				std::vector<id_type> m_nearestID;
+					// per point of m_a: nearest neighbor distance and id (PS_MEAN).
+				std::vector<int> m_distCals;
+
+#ifdef HAVE_PTHREAD_H
+				pthread_rwlock_t m_rwLock;
+#endif
+			}; // PointScanTask
+
 			class ValidateEntry
 			{
 			public:
@@ -220,6 +570,7 @@ namespace SpatialIndex
 			friend class Leaf;
 			friend class Index;
 			friend class BulkLoader;
+			friend class HausdorffMatrixTask;
 
 			friend std::ostream& operator<<(std::ostream& os, const RTree& t);
 		}; // RTree
@@ -310,46 +310,51 @@ double Point::getHausDistUB(const IShape& s) const
 }
 
 /*
- *  For 2D Only.
- *
  *  The function computes the MinFarthestDist from
- *  the point (this) to the region s. This is done
- *  by (i) computing the distances from the point
- *  to the four corners of s; (ii) computing the
- *  MaxDist from the point to each faces; (iii)
- *  retaining the minimum MaxDist.
+ *  the point (this) to the region s, the smallest
+ *  MaxDist from the point to a face of s. Every face
+ *  of a tight MBR touches a point, so the nearest
+ *  neighbor inside s is never farther than this.
+ *
+ *  The MaxDist to the face along dimension d differs
+ *  from the MaxDist to s only in the term of d, so
+ *  all 2 * d faces take O(d). D is the number of
+ *  dimensions when known at compile time, so that the
+ *  loop is unrolled for 2 and 3, or 0 to use dimension.
  */
-double Point::getHausDistUB(const Region& s) const
+template <uint32_t D>
+static double getHausDistUBSq(const double* p, const Region& s, uint32_t dimension)
 {
-	if (this->m_dimension != 2 || s.m_dimension != 2) {
-		throw Tools::NotSupportedException(
-			"Region::getHausDistUB: #dimensions not supported"
-		);
-	}
+	const uint32_t n = (D == 0) ? dimension : D;
+	double sum = 0.0;
+	double best = 0.0;
 
-	Point sw = Point(s.m_pLow, 2);
-	Point ne = Point(s.m_pHigh, 2);
+	for (uint32_t cDim = 0; cDim < n; ++cDim)
+	{
+		double low = (p[cDim] - s.m_pLow[cDim]) * (p[cDim] - s.m_pLow[cDim]);
+		double high = (p[cDim] - s.m_pHigh[cDim]) * (p[cDim] - s.m_pHigh[cDim]);
 
-	double coor[2];
-	coor[0] = s.m_pHigh[0];
-	coor[1] = s.m_pLow[1];
-	Point se = Point(coor, 2);
+		sum += std::max(low, high);
+		best = std::max(best, std::max(low, high) - std::min(low, high));
+	}
 
-	coor[0] = s.m_pLow[0];
-	coor[1] = s.m_pHigh[1];
-	Point nw = Point(coor, 2);
+	return sum - best;
+}
+
+double Point::getHausDistUB(const Region& s) const
+{
+	if (this->m_dimension != s.m_dimension)
+		throw Tools::IllegalArgumentException(
+			"Point::getHausDistUB: Shapes have different number of dimensions."
+		);
 
-	double distSWsq = this->getDistanceSq(sw);
-	double distNEsq = this->getDistanceSq(ne);
-	double distSEsq = this->getDistanceSq(se);
-	double distNWsq = this->getDistanceSq(nw);
+	double dSq;
 
-	double dSq = std::max(distSWsq,distSEsq);
-	dSq = std::min(dSq,std::max(distSEsq,distNEsq));
-	dSq = std::min(dSq,std::max(distNEsq,distNWsq));
-	dSq = std::min(dSq,std::max(distNWsq,distSWsq));
+	if (m_dimension == 2) dSq = getHausDistUBSq<2>(m_pCoords, s, 2);
+	else if (m_dimension == 3) dSq = getHausDistUBSq<3>(m_pCoords, s, 3);
+	else dSq = getHausDistUBSq<0>(m_pCoords, s, m_dimension);
 
-	return std::sqrt(dSq);
+	return std::sqrt(std::max(0.0, dSq));
 }
 
 double Point::getHausDistUB(const Point& s) const
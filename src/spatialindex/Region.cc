@@ -56,13 +56,6 @@ Region::Region(const Point& low, const Point& high)
 Region::Region(const Region& r)
 {
 	initialize(r.m_pLow, r.m_pHigh, r.m_dimension);
-	if (this->m_vec_pEdge.empty()) {
-		for (int i=0; i < 4; i++) {
-			Region *pR = new Region(2);
-			this->getEdge(i,*pR);
-			this->m_vec_pEdge.push_back(pR);
-		}
-	}
 }
 
 void Region::initialize(const double* pLow, const double* pHigh, uint32_t dimension)
@@ -125,10 +118,6 @@ Region::~Region()
 {
 	delete[] m_pLow;
 	delete[] m_pHigh;
-
-	for (int i=0; i < this->m_vec_pEdge.size(); i++) {
-		delete this->m_vec_pEdge.at(i);
-	}
 }
 
 Region& Region::operator=(const Region& r)
@@ -264,14 +253,6 @@ uint32_t Region::getDimension() const
 void Region::getMBR(Region& out) const
 {
 	out = *this;
-
-
-	out.m_vec_pEdge.clear();
-	for (int i=0; i < 4; i++) {
-		Region *pR = new Region(2);
-		out.getEdge(i,*pR);
-		out.m_vec_pEdge.push_back(pR);
-	}
 }
 
 double Region::getArea() const
@@ -604,51 +585,77 @@ std::ostream& SpatialIndex::operator<<(std::ostream& os, const Region& r)
 /*
  *  Added by Yi 5/19/2011
  * 	Computing HausDistLB from an MBR to another MBR or a point.
+ *
+ *  Every face of a tight MBR touches a point, so the directed distance is at
+ *  least the largest distance from a face to r. The kernels below work on the
+ *  squared distance along each dimension and swap in the one of the fixed
+ *  coordinate of a face, so all 2 * d faces take O(d). D is the number of
+ *  dimensions when it is known at compile time, so that the loops are unrolled
+ *  for 2 and 3, or 0 to use dimension.
  */
 
-double Region::getHausDistLB(Region r) const
+static inline double getIntervalMinimumDistanceSq(double v, double low, double high)
 {
-	if (this->m_dimension != 2) {
-		throw Tools::NotSupportedException(
-			"Region::getHausDistUB: #dimensions not supported"
-		);
-	}
+	double x = 0.0;
+	if (v < low) x = low - v;
+	else if (v > high) x = v - high;
+	return x * x;
+}
+
+static inline double getIntervalMaximumDistanceSq(double v, double low, double high)
+{
+	double x = std::max(std::abs(v - low), std::abs(v - high));
+	return x * x;
+}
+
+template <uint32_t D>
+static double getHausDistLBSq(const Region& a, const Region& r, uint32_t dimension)
+{
+	const uint32_t n = (D == 0) ? dimension : D;
+	double sum = 0.0;
+	double best = -std::numeric_limits<double>::max();
+
+	for (uint32_t cDim = 0; cDim < n; ++cDim)
+	{
+		double low = getIntervalMinimumDistanceSq(a.m_pLow[cDim], r.m_pLow[cDim], r.m_pHigh[cDim]);
+		double high = getIntervalMinimumDistanceSq(a.m_pHigh[cDim], r.m_pLow[cDim], r.m_pHigh[cDim]);
+
+		double x = 0.0;
+		if (r.m_pHigh[cDim] < a.m_pLow[cDim]) x = a.m_pLow[cDim] - r.m_pHigh[cDim];
+		else if (a.m_pHigh[cDim] < r.m_pLow[cDim]) x = r.m_pLow[cDim] - a.m_pHigh[cDim];
 
-	//Region edge1 = Region(2);
-	//Region r = Region(2);
-	//s.getMBR(r);
-	//std::cout << "s: " << r.m_pLow[0] << " " << r.m_pLow[1] << " " << r.m_pHigh[0] << " " << r.m_pHigh[1] << std::endl;
-	double max = std::numeric_limits<double>::min();
-	for (int i=0; i<4; i++) {
-		//this->getEdge(i,edge1);
-		max = std::max(max, this->m_vec_pEdge[i]->getMinimumDistanceSq(r));
-		//std::cout << "e: " << edge1.m_pLow[0] << " " << edge1.m_pLow[1] << " " << edge1.m_pHigh[0] << " " << edge1.m_pHigh[1] << std::endl;
-		//std::cout << "Distance: " << std::sqrt(edge1.getMinimumDistanceSq(s)) << std::endl;
+		sum += x * x;
+		best = std::max(best, std::max(low, high) - x * x);
 	}
 
-	return std::sqrt(max);
+	return std::max(0.0, sum + best);
 }
 
-double Region::getHausDistLB(const std::vector<const Region*> vec_pMBR, double max, int& counter) const
+double Region::getHausDistLB(const Region& r) const
 {
+	if (m_dimension != r.m_dimension)
+		throw Tools::IllegalArgumentException(
+			"Region::getHausDistLB: Regions have different number of dimensions."
+		);
 
-	//if (this->m_dimension != 2) {
-		//throw Tools::NotSupportedException(
-			//"Region::getHausDistUB: #dimensions not supported"
-		//);
-	//}
+	double ret;
 
-	max = max*max;
-	//Region edge1 = Region(2);
+	if (m_dimension == 2) ret = getHausDistLBSq<2>(*this, r, 2);
+	else if (m_dimension == 3) ret = getHausDistLBSq<3>(*this, r, 3);
+	else ret = getHausDistLBSq<0>(*this, r, m_dimension);
+
+	return std::sqrt(ret);
+}
 
+double Region::getHausDistLB(const std::vector<const Region*>& vec_pMBR, double max, int& counter) const
+{
+	max = max*max;
 
-	for (int i=0; i<4; i++) {
-		//this->getEdge(i,edge1);
+	for (uint32_t i = 0; i < getNumberOfFaces(); i++) {
 		double min = std::numeric_limits<double>::max();
 
 		for (int j=0; j<  vec_pMBR.size(); j++) {
-			min = std::min(min,this->m_vec_pEdge.at(i)->getMinimumDistanceSq(*(vec_pMBR[j])));
-			//min = std::min(min,edge1.getMinimumDistanceSq(*(vec_pMBR[j])));
+			min = std::min(min,this->getFaceMinimumDistanceSq(i, *(vec_pMBR[j])));
 			counter++;
 			if (min < max) break;
 		}
@@ -667,29 +674,15 @@ double Region::getHausDistLB(const std::vector<const Region*> vec_pMBR, double m
 
 double Region::getMHausDistLB(const IShape& s) const
 {
-	if (this->m_dimension != 2) {
-		throw Tools::NotSupportedException(
-			"Region::getHausDistUB: #dimensions not supported"
-		);
-	}
-
   return std::sqrt(this->getMinimumDistanceSq(s));
 }
 
-double Region::getMHausDistLB(const std::vector<const Region*> vec_pMBR, double max) const
+double Region::getMHausDistLB(const std::vector<const Region*>& vec_pMBR, double max) const
 {
-
-	if (this->m_dimension != 2) {
-		throw Tools::NotSupportedException(
-			"Region::getHausDistUB: #dimensions not supported"
-		);
-	}
-
   double min = std::numeric_limits<double>::max();
 
   for (int j=0; j<  vec_pMBR.size(); j++) {
     min = std::min(min,this->getMinimumDistanceSq(*(vec_pMBR[j])));
-    //if (min==0) break;
   }
 
 	return std::sqrt(min);
@@ -714,18 +707,23 @@ double Region::getHausDistUB(const IShape& s) const
 	);
 }
 
+/*
+ *  The largest, over the faces of this region, of the smallest MaxDist from the
+ *  face to a face of s.
+ */
+
 double Region::getHausDistUB(const Region& s) const
 {
-	Region edge1 = Region(2);
-	Region edge2 = Region(2);
+	if (m_dimension != s.m_dimension)
+		throw Tools::IllegalArgumentException(
+			"Region::getHausDistUB: Regions have different number of dimensions."
+		);
 
-	double max = std::numeric_limits<double>::min();
-	for (int i=0; i<4; i++) {
-		this->getEdge(i,edge1);
+	double max = 0.0;
+	for (uint32_t i = 0; i < getNumberOfFaces(); i++) {
 		double min = std::numeric_limits<double>::max();
-		for (int j=0; j<4; j++) {
-			this->getEdge(j,edge2);
-			min = std::min(min,edge1.getMaximumDistanceSq(edge2));
+		for (uint32_t j = 0; j < s.getNumberOfFaces(); j++) {
+			min = std::min(min, getFaceMaximumDistanceSq(i, s, j));
 		}
 		max = std::max(max,min);
 	}
@@ -733,50 +731,38 @@ double Region::getHausDistUB(const Region& s) const
 	return std::sqrt(max);
 }
 
+/*
+ *  The distance from s to the farthest corner of this region.
+ */
+
 double Region::getHausDistUB(const Point& s) const
 {
-	Point sw = Point(this->m_pLow, 2);
-	Point ne = Point(this->m_pHigh, 2);
-
-	double coor[2];
-	coor[0] = this->m_pHigh[0];
-	coor[1] = this->m_pLow[1];
-	Point se = Point(coor, 2);
+	if (m_dimension != s.m_dimension)
+		throw Tools::IllegalArgumentException(
+			"Region::getHausDistUB: Point has different number of dimensions."
+		);
 
-	coor[0] = this->m_pLow[0];
-	coor[1] = this->m_pHigh[1];
-	Point nw = Point(coor, 2);
+	double dSq = 0.0;
 
-	double dSq = s.getDistanceSq(sw);
-	dSq = std::max(dSq,s.getDistanceSq(ne));
-	dSq = std::max(dSq,s.getDistanceSq(se));
-	dSq = std::max(dSq,s.getDistanceSq(nw));
+	for (uint32_t i = 0; i < m_dimension; ++i)
+	{
+		dSq += getIntervalMaximumDistanceSq(s.m_pCoords[i], m_pLow[i], m_pHigh[i]);
+	}
 
 	return std::sqrt(dSq);
 }
 
-double Region::getHausDistUB(const std::vector<const IShape*> vec_pShape) const
+double Region::getHausDistUB(const std::vector<const IShape*>& vec_pShape) const
 {
+	Region r;
 
-	if (this->m_dimension != 2) {
-		throw Tools::NotSupportedException(
-			"Region::getHausDistUB: #dimensions not supported"
-		);
-	}
-
-	Region edge1 = Region(2);
-	Region edge2 = Region(2);
-	Region r = Region(2);
-
-	double max = std::numeric_limits<double>::min();
-	for (int i=0; i<4; i++) {
-		this->getEdge(i,edge1);
+	double max = 0.0;
+	for (uint32_t i = 0; i < getNumberOfFaces(); i++) {
 		double min = std::numeric_limits<double>::max();
 		for (int j=0; j<  vec_pShape.size(); j++) {
 			vec_pShape[j]->getMBR(r);
-			for (int k=0; k < 4; k++) {
-				r.getEdge(k,edge2);
-				min = std::min(min,edge1.getMaximumDistanceSq(edge2));
+			for (uint32_t k = 0; k < r.getNumberOfFaces(); k++) {
+				min = std::min(min, getFaceMaximumDistanceSq(i, r, k));
 			}
 		}
 
@@ -886,51 +872,138 @@ double Region::getMaximumDistanceSq(const Region& r) const
 
 
 
+/*
+ *  Faces are numbered 2 * d for the low face along dimension d and 2 * d + 1
+ *  for the high one. A face is stored as a region that is flat along d.
+ */
+
+uint32_t Region::getNumberOfFaces() const
+{
+	return 2 * m_dimension;
+}
+
+void Region::getFace(uint32_t faceId, Region& face) const
+{
+	face.makeDimension(m_dimension);
+	getFace(faceId, face.m_pLow, face.m_pHigh);
+}
+
+void Region::getFace(uint32_t faceId, double* pLow, double* pHigh) const
+{
+	if (faceId >= getNumberOfFaces())
+		throw Tools::IndexOutOfBoundsException(faceId);
+
+	memcpy(pLow, m_pLow, m_dimension * sizeof(double));
+	memcpy(pHigh, m_pHigh, m_dimension * sizeof(double));
+
+	uint32_t cFace = faceId / 2;
+	if (faceId % 2 == 0) pHigh[cFace] = m_pLow[cFace];
+	else pLow[cFace] = m_pHigh[cFace];
+}
+
+/*
+ *  The 2D edges are named after the sides of a map, in the order south, east,
+ *  north, west. Other numbers of dimensions use the numbering of getFace.
+ */
+
 void Region::getEdge(int edgeId, Region& edge) const
+{
+	edge.makeDimension(m_dimension);
+	getEdge(edgeId, edge.m_pLow, edge.m_pHigh);
+}
+
+void Region::getEdge(int edgeId, double* pLow, double* pHigh) const
 {
 	if (this->m_dimension != 2) {
-		throw Tools::NotSupportedException(
-			"Region::getEdge: #dimensions not supported"
-		);
+		getFace(edgeId, pLow, pHigh);
+		return;
 	}
 
 	switch (edgeId) {
 		case (0): // South Edge sw->se
-			edge.m_pLow[1] = m_pLow[1]; // South
-			edge.m_pLow[0] = m_pLow[0]; // West
-
-			edge.m_pHigh[1] = m_pLow[1]; // South
-			edge.m_pHigh[0] = m_pHigh[0]; // East
+			getFace(2, pLow, pHigh);
 			break;
 
-
 		case (1): // East Edge se->ne
-			edge.m_pLow[1] = m_pLow[1]; // South
-			edge.m_pLow[0] = m_pHigh[0]; // East
-
-			edge.m_pHigh[1] = m_pHigh[1]; // North
-			edge.m_pHigh[0] = m_pHigh[0]; // East
+			getFace(1, pLow, pHigh);
 			break;
 
-
 		case (2): // North Edge nw->ne
-			edge.m_pLow[1] = m_pHigh[1]; // North
-			edge.m_pLow[0] = m_pLow[0]; // West
+			getFace(3, pLow, pHigh);
+			break;
 
-			edge.m_pHigh[1] = m_pHigh[1]; // North
-			edge.m_pHigh[0] = m_pHigh[0]; // East
+		default: // West Edge sw->nw
+			getFace(0, pLow, pHigh);
 			break;
+	}
+}
 
+/*
+ *  Faces are not stored, the distance from a face is computed from the
+ *  low and high coordinates so that copying a region does not allocate them.
+ */
 
-		default: // West Edge sw->nw
-			edge.m_pLow[1] = m_pLow[1]; // South
-			edge.m_pLow[0] = m_pLow[0]; // West
+double Region::getFaceMinimumDistanceSq(uint32_t faceId, const Region& r) const
+{
+	if (m_dimension != r.m_dimension)
+		throw Tools::IllegalArgumentException(
+			"Region::getFaceMinimumDistanceSq: Regions have different number of dimensions."
+		);
 
-			edge.m_pHigh[1] = m_pHigh[1]; // North
-			edge.m_pHigh[0] = m_pLow[0]; // West
-			break;
+	uint32_t cFace = faceId / 2;
+	double ret = 0.0;
+
+	for (uint32_t i = 0; i < m_dimension; ++i)
+	{
+		if (i == cFace)
+		{
+			double v = (faceId % 2 == 0) ? m_pLow[i] : m_pHigh[i];
+			ret += getIntervalMinimumDistanceSq(v, r.m_pLow[i], r.m_pHigh[i]);
+			continue;
+		}
+
+		double x = 0.0;
+
+		if (r.m_pHigh[i] < m_pLow[i]) x = m_pLow[i] - r.m_pHigh[i];
+		else if (m_pHigh[i] < r.m_pLow[i]) x = r.m_pLow[i] - m_pHigh[i];
+
+		ret += x * x;
 	}
+
+	return ret;
 }
 
+double Region::getFaceMaximumDistanceSq(uint32_t faceId, const Region& r, uint32_t rFaceId) const
+{
+	if (m_dimension != r.m_dimension)
+		throw Tools::IllegalArgumentException(
+			"Region::getFaceMaximumDistanceSq: Regions have different number of dimensions."
+		);
+
+	uint32_t cFace = faceId / 2;
+	uint32_t cRFace = rFaceId / 2;
+	double ret = 0.0;
+
+	for (uint32_t i = 0; i < m_dimension; ++i)
+	{
+		double low = m_pLow[i], high = m_pHigh[i];
+		double rLow = r.m_pLow[i], rHigh = r.m_pHigh[i];
+
+		if (i == cFace)
+		{
+			if (faceId % 2 == 0) high = low;
+			else low = high;
+		}
+
+		if (i == cRFace)
+		{
+			if (rFaceId % 2 == 0) rHigh = rLow;
+			else rLow = rHigh;
+		}
 
+		double x = std::max(std::abs(low - rHigh), std::abs(high - rLow));
+		ret += x * x;
+	}
 
+	return ret;
+}
@@ -21,6 +21,12 @@
 
 #include <time.h>
 #include <limits>
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
 #include "../../include/tools/Tools.h"
 #include "../../include/tools/rand48.h"
 
@@ -728,6 +734,145 @@ Tools::ExclusiveLock::~ExclusiveLock()
 }
 #endif
 
+uint32_t Tools::getNumberOfProcessors()
+{
+#if defined(HAVE_PTHREAD_H) && defined(_SC_NPROCESSORS_ONLN)
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n > 0) return static_cast<uint32_t>(n);
+#endif
+	return 1;
+}
+
+double Tools::getCurrentTime()
+{
+#ifdef _MSC_VER
+	return static_cast<double>(clock()) * 1000.0 / CLOCKS_PER_SEC;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return static_cast<double>(tv.tv_sec) * 1000.0 + static_cast<double>(tv.tv_usec) / 1000.0;
+#endif
+}
+
+#if HAVE_PTHREAD_H
+class ParallelRun
+{
+public:
+	Tools::IParallelTask* m_pTask;
+	uint32_t m_count;
+	uint32_t m_next;
+	pthread_mutex_t m_lock;
+	bool m_bFailed;
+	std::string m_error;
+}; // ParallelRun
+
+class ParallelWorker
+{
+public:
+	ParallelRun* m_pRun;
+	uint32_t m_thread;
+}; // ParallelWorker
+
+static void* runParallelWorker(void* arg)
+{
+	ParallelWorker* w = static_cast<ParallelWorker*>(arg);
+	ParallelRun* r = w->m_pRun;
+
+	while (true)
+	{
+		pthread_mutex_lock(&(r->m_lock));
+		uint32_t index = r->m_next;
+		if (index < r->m_count) ++(r->m_next);
+		pthread_mutex_unlock(&(r->m_lock));
+
+		if (index >= r->m_count) break;
+
+		std::string error;
+
+		try
+		{
+			r->m_pTask->run(index, w->m_thread);
+			continue;
+		}
+		catch (Tools::Exception& e)
+		{
+			error = e.what();
+		}
+		catch (std::exception& e)
+		{
+			error = e.what();
+		}
+		catch (...)
+		{
+			error = "Unknown Error";
+		}
+
+		// keep the first error and stop handing out items.
+		pthread_mutex_lock(&(r->m_lock));
+		if (! r->m_bFailed)
+		{
+			r->m_bFailed = true;
+			r->m_error = error;
+		}
+		r->m_next = r->m_count;
+		pthread_mutex_unlock(&(r->m_lock));
+		break;
+	}
+
+	return 0;
+}
+#endif
+
+void Tools::runParallel(IParallelTask& task, uint32_t count, uint32_t threads)
+{
+	if (threads == 0) threads = getNumberOfProcessors();
+	if (threads > count) threads = count;
+
+#if HAVE_PTHREAD_H
+	if (threads > 1)
+	{
+		ParallelRun r;
+		r.m_pTask = &task;
+		r.m_count = count;
+		r.m_next = 0;
+		r.m_bFailed = false;
+		pthread_mutex_init(&(r.m_lock), NULL);
+
+		std::vector<pthread_t> ids(threads);
+		std::vector<ParallelWorker> workers(threads);
+		uint32_t started = 0;
+
+		for (uint32_t cThread = 1; cThread < threads; ++cThread)
+		{
+			workers[cThread].m_pRun = &r;
+			workers[cThread].m_thread = cThread;
+			if (pthread_create(&(ids[cThread]), NULL, runParallelWorker, &(workers[cThread])) != 0) break;
+			++started;
+		}
+
+		// the calling thread is worker 0.
+		workers[0].m_pRun = &r;
+		workers[0].m_thread = 0;
+		runParallelWorker(&(workers[0]));
+
+		for (uint32_t cThread = 1; cThread <= started; ++cThread)
+		{
+			pthread_join(ids[cThread], NULL);
+		}
+
+		pthread_mutex_destroy(&(r.m_lock));
+
+		if (r.m_bFailed) throw IllegalStateException("runParallel: " + r.m_error);
+		return;
+	}
+#endif
+
+	for (uint32_t cIndex = 0; cIndex < count; ++cIndex)
+	{
+		task.run(cIndex, 0);
+	}
+}
+
 std::ostream& Tools::operator<<(std::ostream& os, const Tools::PropertySet& p)
 {
 	std::map<std::string, Variant>::const_iterator it;
@@ -407,6 +407,11 @@ double SpatialIndex::TPRTree::TPRTree::mhausdorff(ISpatialIndex& query, uint64_t
   //throw Tools::IllegalArgumentException("MDA: Got Here!");
 }
 
+double SpatialIndex::TPRTree::TPRTree::symmetricHausdorff(ISpatialIndex& query, uint64_t& id1, uint64_t& id2, int mode, IVisitor& v)
+{
+	throw Tools::IllegalStateException("symmetricHausdorff: not impelmented yet.");
+}
+
 void SpatialIndex::TPRTree::TPRTree::clearMBRs()
 {
 